@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace orion
+{
+    // Linear allocator for data living until the end of a frame
+    //  Allocations bump a pointer through one buffer and are all freed at once by reset().
+    //  Frames outgrowing the buffer fall back to separate blocks, reset() then grows the buffer
+    //  to fit, so frames of the same size stop allocating after the first one.
+    class FrameArena final : public std::pmr::memory_resource
+    {
+    public:
+        explicit FrameArena(std::size_t capacity = 64 * 1024);
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        // Every allocation made since the last reset must no longer be in use
+        void reset();
+
+        std::size_t capacity() const { return capacity_; }
+        std::size_t used() const { return offset_ + overflow_bytes_; }
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        std::unique_ptr<std::byte[]> buffer_;
+        std::size_t capacity_ = 0;
+        std::size_t offset_ = 0;
+        std::vector<std::unique_ptr<std::byte[]>> overflow_blocks_;
+        std::size_t overflow_bytes_ = 0;
+    };
+} // namespace orion
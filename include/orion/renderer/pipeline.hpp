@@ -5,7 +5,17 @@
 #include <tl/expected.hpp>
 
 #include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -20,10 +30,65 @@ namespace orion
         Opaque = 0,
     };
 
+    // SPIR-V code of a shader, resident for as long as pipelines can be created from it
+    struct ShaderModule {
+        std::vector<std::uint32_t> code;
+        std::uint64_t hash;
+        // Created on first use, pipelines found in the pipeline cache by identifier never need it
+        VkShaderModule module = VK_NULL_HANDLE;
+        // Zero sized without VK_EXT_shader_module_identifier
+        VkShaderModuleIdentifierEXT identifier;
+    };
+
+    // Shader modules shared by all pipelines
+    //  Files are read once, shaders are keyed by the hash of their code so identical shaders share one module.
+    //  Safe to use from the compile threads.
+    class ShaderModuleCache
+    {
+    public:
+        ShaderModuleCache(VkDevice device, bool use_identifiers);
+        ShaderModuleCache(const ShaderModuleCache&) = delete;
+        ShaderModuleCache& operator=(const ShaderModuleCache&) = delete;
+        ~ShaderModuleCache();
+
+        ShaderModule& load(const ShaderPath& shader);
+        tl::expected<VkShaderModule, VkResult> get_module(ShaderModule& shader);
+
+        // Pipelines are first looked up in the pipeline cache by the identifiers of their shader modules
+        bool uses_identifiers() const { return use_identifiers_; }
+
+    private:
+        VkDevice vk_device_;
+        bool use_identifiers_;
+        std::mutex mutex_;
+        std::unordered_map<std::string, std::uint64_t> shader_hashes_;
+        std::unordered_map<std::uint64_t, ShaderModule> shaders_;
+    };
+
+    // Parts of a pipeline compiled separately into pipeline libraries with VK_EXT_graphics_pipeline_library
+    enum class PipelinePart {
+        VertexInput = 0,
+        PreRasterization,
+        FragmentShader,
+        FragmentOutput,
+    };
+
+    inline constexpr std::size_t pipeline_part_count = 4;
+
+    // Libraries of every part of one pipeline, indexed by PipelinePart
+    using PipelineLibraries = std::array<VkPipeline, pipeline_part_count>;
+
+    // Canonical pipeline state, pipelines and libraries are deduplicated by comparing it whole
+    using PipelineStateKey = std::vector<std::byte>;
+
+    struct PipelineStateHash {
+        [[nodiscard]] std::size_t operator()(const PipelineStateKey& key) const;
+    };
+
     class PipelineBuilder
     {
     public:
-        explicit PipelineBuilder(VkPipelineLayout layout);
+        PipelineBuilder(VkPipelineLayout layout, ShaderModuleCache& shader_modules);
 
         // Shaders
 
@@ -34,6 +99,8 @@ namespace orion
 
         void add_color_attachment(VkFormat format, BlendMode blend_mode = BlendMode::Opaque);
         void set_depth_attachment(VkFormat format);
+        // Views rendered with multiview, must match the view mask of the rendering the pipeline is used in
+        void set_view_mask(std::uint32_t view_mask);
 
         // Vertex input state
 
@@ -55,21 +122,48 @@ namespace orion
         void set_cull_mode(VkCullModeFlags cull_mode);
         void set_front_face(VkFrontFace front_face);
 
+        // Multisample state
+
+        // Must match the sample count of the attachments rendered to
+        void set_sample_count(VkSampleCountFlagBits samples);
+
+        // Canonical state of the pipeline, equal for builders creating identical pipelines
+        PipelineStateKey state_key() const;
+        // Only the state a part is compiled from, also differs between parts
+        PipelineStateKey state_key(PipelinePart part) const;
+        // 64-bit hash of the state key
+        std::uint64_t hash() const;
+
         // Build the create info
-        tl::expected<VkPipeline, VkResult> build(VkDevice device);
+        tl::expected<VkPipeline, VkResult> build(VkDevice device, VkPipelineCache pipeline_cache = VK_NULL_HANDLE);
 
     private:
+        friend class PipelineCompiler;
+        friend class PipelineLibraryCache;
+
+        // Creates the pipelines of all builders with as few vkCreateGraphicsPipelines() calls as possible
+        //  With shader module identifiers the pipelines are looked up in the pipeline cache first,
+        //  only the ones missing from it are compiled from their shader modules.
+        static std::vector<tl::expected<VkPipeline, VkResult>> build_batch(VkDevice device, VkPipelineCache pipeline_cache, std::span<PipelineBuilder* const> builders);
+        // Returns the builders whose pipelines were not created
+        static std::vector<std::size_t> create_pipelines(VkDevice device, VkPipelineCache pipeline_cache, std::span<PipelineBuilder* const> builders,
+                                                         std::span<const std::size_t> indices, bool use_identifiers,
+                                                         std::span<tl::expected<VkPipeline, VkResult>> results);
+        tl::expected<void, VkResult> set_stage_shaders(bool use_identifiers);
+        VkGraphicsPipelineCreateInfo to_create_info(VkPipelineCreateFlags flags) const;
+        void append_state_key(PipelinePart part, PipelineStateKey& key) const;
+        // Only the state of the part, shader stages must be set
+        VkGraphicsPipelineCreateInfo to_library_create_info(PipelinePart part) const;
+
         static constexpr auto dynamic_states = std::array{
             VK_DYNAMIC_STATE_VIEWPORT,
             VK_DYNAMIC_STATE_SCISSOR,
         };
 
+        ShaderModuleCache* shader_modules_;
         std::vector<VkPipelineShaderStageCreateInfo> shader_stages_;
-
-        VkShaderModuleCreateInfo vs_info_;
-        VkShaderModuleCreateInfo fs_info_;
-        std::vector<std::uint32_t> vs_code_;
-        std::vector<std::uint32_t> fs_code_;
+        std::array<ShaderModule*, 2> stage_shaders_ = {};
+        std::array<VkPipelineShaderStageModuleIdentifierCreateInfoEXT, 2> stage_identifiers_ = {};
 
         VkPipelineRenderingCreateInfo rendering_state_;
         std::vector<VkFormat> color_attachments_;
@@ -89,6 +183,49 @@ namespace orion
 
         VkPipelineDynamicStateCreateInfo dynamic_state_;
         VkPipelineLayout layout_;
+
+        // Indexed by PipelinePart
+        std::array<VkGraphicsPipelineLibraryCreateInfoEXT, pipeline_part_count> library_infos_;
+    };
+
+    // Pipeline libraries of the parts pipelines are linked from
+    //  Each distinct part is compiled once and shared by every pipeline combining it with other parts.
+    //  Safe to use from the compile threads.
+    class PipelineLibraryCache
+    {
+    public:
+        // Libraries are created with the layout pipelines are linked with
+        PipelineLibraryCache(VkDevice device, VkPipelineCache pipeline_cache, VkPipelineLayout pipeline_layout);
+        PipelineLibraryCache(const PipelineLibraryCache&) = delete;
+        PipelineLibraryCache& operator=(const PipelineLibraryCache&) = delete;
+        ~PipelineLibraryCache();
+
+        // Libraries of all parts of the builder, the missing ones are created
+        tl::expected<PipelineLibraries, VkResult> get_libraries(PipelineBuilder& builder);
+        // Fast linking only combines the compiled libraries
+        //  Link time optimization takes about as long as creating the pipeline without libraries, for faster code.
+        tl::expected<VkPipeline, VkResult> link(const PipelineLibraries& libraries, bool link_time_optimize) const;
+
+        // Linked pipelines replaced by their optimized version, command buffers may still use them
+        void retire(VkPipeline pipeline);
+        // Pipelines retired since the last call were used by frames up to frame_value at the latest
+        //  They are destroyed once the GPU reached their frame with completed_value.
+        void destroy_retired(std::uint64_t frame_value, std::uint64_t completed_value);
+
+    private:
+        struct RetiredPipeline {
+            VkPipeline pipeline;
+            // Not known before the next destroy_retired()
+            std::uint64_t frame_value = UINT64_MAX;
+        };
+
+        VkDevice vk_device_;
+        VkPipelineCache vk_pipeline_cache_;
+        VkPipelineLayout pipeline_layout_;
+        std::mutex mutex_;
+        // Keyed by PipelineBuilder::state_key(PipelinePart)
+        std::unordered_map<PipelineStateKey, VkPipeline, PipelineStateHash> libraries_;
+        std::vector<RetiredPipeline> retired_pipelines_;
     };
 
     template<typename F>
@@ -96,31 +233,110 @@ namespace orion
         setup(builder);
     };
 
+    // Compact handle of a pipeline in the pipeline cache, valid for the lifetime of the cache
+    //  Builds of identical pipeline state return the same id.
+    struct PipelineId {
+        std::uint32_t index;
+
+        friend bool operator==(PipelineId, PipelineId) = default;
+    };
+
+    // Resolves once a pipeline built in the background is created or failed
+    //  Carries no handle, the fast linked pipeline is replaced and destroyed later so it is always looked up with get().
+    using PipelineFuture = std::shared_future<tl::expected<void, VkResult>>;
+
+    class PipelineCompiler;
+
+    struct PipelineCacheDesc {
+        VkDevice device;
+        const VkPhysicalDeviceProperties& device_properties;
+        // The driver's pipeline cache is seeded from the file when it was written for the same device and driver
+        //  Missing, stale or corrupted files start an empty cache instead.
+        std::filesystem::path cache_file;
+        // Worker threads compiling the pipelines built with build_async()
+        std::size_t compile_threads;
+        // VK_EXT_shader_module_identifier is enabled
+        bool shader_module_identifiers = false;
+        // VK_EXT_graphics_pipeline_library is enabled
+        //  Pipelines are fast linked from libraries and replaced by a link time optimized version built in the background.
+        bool graphics_pipeline_library = false;
+    };
+
     class PipelineCache
     {
     public:
-        static tl::expected<PipelineCache, VkResult> initialize(VkDevice device);
+        static tl::expected<PipelineCache, VkResult> initialize(const PipelineCacheDesc& desc);
         PipelineCache(const PipelineCache&) = delete;
         PipelineCache& operator=(const PipelineCache&) = delete;
         PipelineCache(PipelineCache&& other) noexcept;
         PipelineCache& operator=(PipelineCache&& other) noexcept;
         ~PipelineCache();
 
-        // Create a new pipeline
-        tl::expected<VkPipeline, VkResult> build(std::string name, PipelineSetupFn auto&& setup)
+        // Create a new pipeline, or reuse the pipeline already built from the same state
+        tl::expected<PipelineId, VkResult> build(std::string name, PipelineSetupFn auto&& setup)
         {
-            auto builder = PipelineBuilder{pipeline_layout_};
+            auto builder = PipelineBuilder{pipeline_layout_, *shader_modules_};
             setup(builder);
             return build(std::move(name), builder);
         }
 
-        // Retrieve an existing pipeline by identifier
-        VkPipeline get(std::string_view name) const;
+        // Queue a new pipeline for compilation on the worker threads
+        //  Until it is ready get() returns the fallback pipeline, or VK_NULL_HANDLE without one so draws can be skipped.
+        //  Setup runs on the calling thread, the driver compiles the queued pipelines in batches.
+        PipelineId build_async(std::string name, PipelineSetupFn auto&& setup, std::optional<PipelineId> fallback = std::nullopt)
+        {
+            auto builder = std::make_unique<PipelineBuilder>(pipeline_layout_, *shader_modules_);
+            setup(*builder);
+            return build_async(std::move(name), std::move(builder), std::move(fallback));
+        }
+
+        // Retrieve an existing pipeline
+        //  Pipelines must not be added while other threads look them up.
+        VkPipeline get(PipelineId id) const;
+        // Look up the id of a pipeline by the name it was built with, meant to be resolved once rather than per draw
+        std::optional<PipelineId> find(std::string_view name) const;
+        // Resolves once the pipeline is created, already resolved for pipelines built synchronously
+        PipelineFuture get_future(PipelineId id) const;
+
+        // Block until every queued pipeline is compiled
+        void wait_idle();
+
+        // Destroy the fast linked pipelines replaced by their optimized version once no frame uses them
+        //  frame_value is the frame about to be recorded, completed_value the last frame the GPU finished.
+        void destroy_retired(std::uint64_t frame_value, std::uint64_t completed_value);
+
+        // Write the driver's pipeline cache back to the cache file, skipped when it did not grow since the last save
+        //  Written to a temporary file renamed over the cache file, an interrupted save leaves the previous file intact.
+        bool save();
 
     private:
-        PipelineCache(VkDevice device, VkPipelineLayout pipeline_layout);
+        // Prepended to the driver's cache data, identifies the driver the data was created by
+        struct FileHeader {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t vendor_id;
+            std::uint32_t device_id;
+            std::uint32_t driver_version;
+            std::array<std::uint8_t, VK_UUID_SIZE> pipeline_cache_uuid;
+            // Keeps the header free of padding, it is written as is
+            std::uint32_t reserved;
+            std::uint64_t data_size;
+            std::uint64_t data_hash;
+        };
+
+        // Stable in the deque while the compile threads publish into it
+        struct PipelineEntry {
+            std::atomic<VkPipeline> pipeline = VK_NULL_HANDLE;
+            std::optional<PipelineId> fallback;
+            PipelineFuture future;
+        };
+
+        PipelineCache(const PipelineCacheDesc& desc, VkPipelineLayout pipeline_layout, VkPipelineCache vk_pipeline_cache, const FileHeader& file_header);
+
+        static FileHeader to_file_header(const VkPhysicalDeviceProperties& device_properties);
+        static std::vector<std::byte> read_cache_file(const std::filesystem::path& cache_file, const FileHeader& file_header);
 
-        struct PipelineHash {
+        struct NameHash {
             using is_transparent = void;
 
             [[nodiscard]] std::size_t operator()(const std::string& str) const
@@ -133,10 +349,27 @@ namespace orion
             }
         };
 
-        tl::expected<VkPipeline, VkResult> build(std::string name, PipelineBuilder& builder);
+        tl::expected<PipelineId, VkResult> build(std::string name, PipelineBuilder& builder);
+        PipelineId build_async(std::string name, std::unique_ptr<PipelineBuilder> builder, std::optional<PipelineId> fallback);
+        void add_name(std::string name, PipelineId id);
+        void destroy();
 
         VkDevice vk_device_;
         VkPipelineLayout pipeline_layout_;
-        std::unordered_map<std::string, VkPipeline, PipelineHash, std::equal_to<>> pipelines_;
+        VkPipelineCache vk_pipeline_cache_;
+        FileHeader file_header_;
+        std::filesystem::path cache_file_;
+        std::size_t saved_size_ = 0;
+        // Referenced by the builders, destroyed after the pipelines created from its modules
+        std::unique_ptr<ShaderModuleCache> shader_modules_;
+        // Without VK_EXT_graphics_pipeline_library pipelines are created whole
+        std::unique_ptr<PipelineLibraryCache> libraries_;
+        // Indexed by PipelineId
+        std::deque<PipelineEntry> pipelines_;
+        // Keyed by PipelineBuilder::state_key(), deduplicates pipelines built from identical state
+        std::unordered_map<PipelineStateKey, PipelineId, PipelineStateHash> pipeline_ids_;
+        std::unordered_map<std::string, PipelineId, NameHash, std::equal_to<>> pipeline_names_;
+        // Joined before the pipelines it compiles into are destroyed
+        std::unique_ptr<PipelineCompiler> compiler_;
     };
 } // namespace orion
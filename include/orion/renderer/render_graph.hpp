@@ -4,16 +4,61 @@
 
 #include <vk_mem_alloc.h>
 
+#include "orion/renderer/frame_arena.hpp"
+
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
-#include <functional>
+#include <limits>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <set>
+#include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace orion
 {
     struct TextureHandle {
+        static constexpr auto all_subresources = std::numeric_limits<std::uint16_t>::max();
+
+        std::uint16_t index;
+        std::uint16_t version = 0;
+        // Mip levels and array layers accessed through the handle, the whole texture by default
+        //  Writing any subresource advances the version of the whole texture.
+        std::uint16_t base_mip_level = 0;
+        std::uint16_t mip_level_count = all_subresources;
+        std::uint16_t base_array_layer = 0;
+        std::uint16_t array_layer_count = all_subresources;
+
+        // Views of the same texture version
+        [[nodiscard]] constexpr TextureHandle mip(std::uint16_t level) const
+        {
+            auto handle = *this;
+            handle.base_mip_level = level;
+            handle.mip_level_count = 1;
+            return handle;
+        }
+        [[nodiscard]] constexpr TextureHandle layer(std::uint16_t array_layer) const
+        {
+            auto handle = *this;
+            handle.base_array_layer = array_layer;
+            handle.array_layer_count = 1;
+            return handle;
+        }
+        [[nodiscard]] constexpr TextureHandle whole() const
+        {
+            return {index, version};
+        }
+    };
+
+    struct BufferHandle {
         std::uint16_t index;
         std::uint16_t version = 0;
     };
@@ -22,7 +67,15 @@ namespace orion
     {
     public:
         VkCommandBuffer cmd() const { return command_buffer_; }
+        // Views only the subresources of the handle, subresource views exist for transient textures
         VkImageView get_image_view(TextureHandle handle) const;
+        // Transient images can be larger than requested, passes render into the requested sub-rect of the handle's mip level
+        VkRect2D get_render_area(TextureHandle handle) const;
+        VkExtent3D get_image_extent(TextureHandle handle) const;
+        // Attachment load and store ops inferred from the accesses of the other passes
+        VkAttachmentLoadOp get_load_op(TextureHandle handle) const;
+        VkAttachmentStoreOp get_store_op(TextureHandle handle) const;
+        VkBuffer get_buffer(BufferHandle handle) const;
 
     private:
         friend class RenderGraph;
@@ -30,8 +83,75 @@ namespace orion
 
         class RenderGraph& graph_;
         VkCommandBuffer command_buffer_;
+        std::size_t position_ = 0;
+    };
+
+    // Pass callback stored inline in the pass instead of on the heap
+    //  Closures larger than storage_size do not compile, capture large state by reference.
+    class RenderPassExecuteFn
+    {
+    public:
+        static constexpr std::size_t storage_size = 64;
+
+        RenderPassExecuteFn() = default;
+        template<typename F>
+            requires(!std::same_as<std::remove_cvref_t<F>, RenderPassExecuteFn> && std::invocable<std::remove_cvref_t<F>&, RenderPassContext&>)
+        RenderPassExecuteFn(F&& fn)
+        {
+            using Fn = std::remove_cvref_t<F>;
+            static_assert(sizeof(Fn) <= storage_size, "Render pass closure does not fit into the inline storage");
+            static_assert(alignof(Fn) <= alignof(std::max_align_t));
+            static_assert(std::is_nothrow_move_constructible_v<Fn>);
+            ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(fn));
+            invoke_ = [](void* storage, RenderPassContext& context) { (*static_cast<Fn*>(storage))(context); };
+            relocate_ = [](void* dst, void* src) noexcept {
+                auto* fn_ptr = static_cast<Fn*>(src);
+                if (dst != nullptr) {
+                    ::new (dst) Fn(std::move(*fn_ptr));
+                }
+                fn_ptr->~Fn();
+            };
+        }
+        RenderPassExecuteFn(const RenderPassExecuteFn&) = delete;
+        RenderPassExecuteFn& operator=(const RenderPassExecuteFn&) = delete;
+        RenderPassExecuteFn(RenderPassExecuteFn&& other) noexcept { move_from(other); }
+        RenderPassExecuteFn& operator=(RenderPassExecuteFn&& other) noexcept
+        {
+            if (this != &other) {
+                reset();
+                move_from(other);
+            }
+            return *this;
+        }
+        ~RenderPassExecuteFn() { reset(); }
+
+        void operator()(RenderPassContext& context) { invoke_(storage_, context); }
+        explicit operator bool() const noexcept { return invoke_ != nullptr; }
+
+    private:
+        void move_from(RenderPassExecuteFn& other) noexcept
+        {
+            if (other.invoke_ == nullptr) {
+                return;
+            }
+            other.relocate_(storage_, other.storage_);
+            invoke_ = std::exchange(other.invoke_, nullptr);
+            relocate_ = std::exchange(other.relocate_, nullptr);
+        }
+        void reset() noexcept
+        {
+            if (relocate_ != nullptr) {
+                relocate_(nullptr, storage_);
+            }
+            invoke_ = nullptr;
+            relocate_ = nullptr;
+        }
+
+        alignas(std::max_align_t) std::byte storage_[storage_size];
+        void (*invoke_)(void*, RenderPassContext&) = nullptr;
+        // Move constructs the closure into dst unless null, then destroys the source
+        void (*relocate_)(void* dst, void* src) noexcept = nullptr;
     };
-    using RenderPassExecuteFn = std::function<void(RenderPassContext&)>;
 
     struct TextureAccess {
         TextureHandle handle;
@@ -40,11 +160,45 @@ namespace orion
         VkAccessFlags2 access;
     };
 
+    struct BufferAccess {
+        BufferHandle handle;
+        VkPipelineStageFlags2 stage;
+        VkAccessFlags2 access;
+    };
+
+    enum class PassQueue {
+        Graphics,
+        AsyncCompute,
+    };
+
+    struct AttachmentClearValue {
+        TextureHandle handle;
+        VkClearValue value;
+    };
+
+    // Multisampled color attachment resolved into a single-sample texture when its rendering scope ends
+    struct AttachmentResolve {
+        TextureHandle source;
+        TextureHandle target;
+        VkResolveModeFlagBits mode;
+    };
+
+    // Declared anew every frame, the lists live in the graph's frame arena
     struct RenderPass {
-        std::string name;
+        // Interned by the graph, stays valid across frames
+        std::string_view name;
         RenderPassExecuteFn execute;
-        std::vector<TextureAccess> texture_accesses;
-        std::vector<VkImageMemoryBarrier2> image_barriers;
+        PassQueue queue = PassQueue::Graphics;
+        // Dynamic rendering begun by the graph, see RenderPassBuilder::set_rendering
+        std::optional<VkRect2D> render_area;
+        // Views rendered at once with multiview, zero renders a single view
+        std::uint32_t view_mask = 0;
+        std::pmr::vector<AttachmentClearValue> clear_values;
+        std::pmr::vector<AttachmentResolve> resolves;
+        std::pmr::vector<TextureAccess> texture_accesses;
+        std::pmr::vector<BufferAccess> buffer_accesses;
+        std::pmr::vector<std::size_t> dependencies;
+        bool culled = false;
     };
 
     enum class TextureUsage {
@@ -52,10 +206,47 @@ namespace orion
         DepthAttachment,
     };
 
+    enum class TextureReadUsage {
+        Sampled,
+        StorageRead,
+        InputAttachment,
+        DepthReadOnly,
+    };
+
+    enum class BufferUsage {
+        StorageWrite,
+        TransferDst,
+    };
+
+    enum class BufferReadUsage {
+        Vertex,
+        Index,
+        Indirect,
+        StorageRead,
+        Uniform,
+        TransferSrc,
+    };
+
     class RenderPassBuilder
     {
     public:
         TextureHandle write_texture(TextureHandle handle, TextureUsage usage);
+        void read_texture(TextureHandle handle, TextureReadUsage usage);
+        BufferHandle write_buffer(BufferHandle handle, BufferUsage usage);
+        void read_buffer(BufferHandle handle, BufferReadUsage usage);
+        // Run the pass on the async compute queue, the pass may only record compute and transfer commands
+        void set_async_compute();
+        // Let the graph begin and end dynamic rendering around the pass with its attachments, in declaration order
+        //  Consecutive passes with compatible attachments are merged into one rendering scope,
+        //  the pass records its draws into its part of the scope and must not begin rendering itself.
+        //  A non-zero view mask renders every view in the mask with one submission using multiview,
+        //  attachments are then layered textures with a layer per view and pipelines share the view mask.
+        void set_rendering(VkRect2D render_area, std::uint32_t view_mask = 0);
+        void set_clear_value(TextureHandle handle, VkClearValue value);
+        // Resolve a multisampled color attachment of the pass into target at the end of its rendering scope
+        //  The scope ends with the pass, a source not read afterwards is stored as don't care
+        //  and can live in lazily allocated memory.
+        TextureHandle resolve_texture(TextureHandle source, TextureHandle target, VkResolveModeFlagBits mode = VK_RESOLVE_MODE_AVERAGE_BIT);
 
     private:
         friend class RenderGraph;
@@ -64,6 +255,9 @@ namespace orion
         RenderPass& pass_;
     };
 
+    class TransientHeap;
+    class RecordingThreadPool;
+
     template<typename F>
     concept RenderPassSetupFn = requires(F setup, RenderPassBuilder& builder) {
         { setup(builder) } -> std::convertible_to<RenderPassExecuteFn>;
@@ -72,7 +266,7 @@ namespace orion
     class RenderGraph
     {
     public:
-        enum class TextureLifetime {
+        enum class ResourceLifetime {
             Transient,
             Persistent,
         };
@@ -83,6 +277,29 @@ namespace orion
             VkImageLayout current_layout;
             VkImageLayout final_layout;
             VkFormat format;
+            // Size of the image, reported by RenderPassContext::get_render_area() and get_image_extent()
+            VkExtent3D extent;
+            std::uint32_t mip_levels = 1;
+            std::uint32_t array_layers = 1;
+            VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+        };
+
+        struct BufferImportDesc {
+            VkBuffer buffer;
+            VkDeviceSize size;
+        };
+
+        struct BufferDesc {
+            VkDeviceSize size;
+            VkBufferUsageFlags usage;
+
+            [[nodiscard]] constexpr friend bool operator<(const BufferDesc& lhs, const BufferDesc& rhs) noexcept
+            {
+                if (lhs.size != rhs.size) {
+                    return lhs.size < rhs.size;
+                }
+                return lhs.usage < rhs.usage;
+            }
         };
 
         struct TextureDesc {
@@ -90,6 +307,9 @@ namespace orion
             VkFormat format;
             VkExtent3D extent;
             VkImageUsageFlags usage;
+            std::uint32_t mip_levels = 1;
+            std::uint32_t array_layers = 1;
+            VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
 
             [[nodiscard]] constexpr friend bool operator<(const TextureDesc& lhs, const TextureDesc& rhs) noexcept
             {
@@ -108,70 +328,463 @@ namespace orion
                 if (lhs.extent.depth != rhs.extent.depth) {
                     return lhs.extent.depth < rhs.extent.depth;
                 }
+                if (lhs.mip_levels != rhs.mip_levels) {
+                    return lhs.mip_levels < rhs.mip_levels;
+                }
+                if (lhs.array_layers != rhs.array_layers) {
+                    return lhs.array_layers < rhs.array_layers;
+                }
+                if (lhs.samples != rhs.samples) {
+                    return lhs.samples < rhs.samples;
+                }
                 return lhs.usage < rhs.usage;
             }
         };
 
+        struct SubresourceState {
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags2 last_stage = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 last_access = VK_ACCESS_2_NONE;
+            // Position of the pass that last accessed the subresource
+            std::size_t last_position = std::numeric_limits<std::size_t>::max();
+        };
+
+        struct SubresourceView {
+            VkImageSubresourceRange range;
+            VkImageView view;
+        };
+
+        struct HistoryImage;
+
         struct Texture {
-            TextureLifetime lifetime = TextureLifetime::Transient;
+            ResourceLifetime lifetime = ResourceLifetime::Transient;
 
             VkImage image = VK_NULL_HANDLE;
             VkImageView image_view = VK_NULL_HANDLE;
+            // Views of the subresource ranges accessed through handles, transient textures only
+            std::vector<SubresourceView> subresource_views;
 
+            // Layout of every subresource when the graph starts
             VkImageLayout current_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkImageLayout final_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            // Tracked while emitting barriers, indexed by mip_level * array_layers + array_layer
+            std::vector<SubresourceState> subresource_states;
+
+            TextureDesc desc;
+
+            // Extent of the backing image, transient images are rounded up to a size bucket
+            VkExtent3D image_extent = {};
+
+            // Accessed by at least one pass that survived culling
+            bool referenced = false;
+
+            // First and last position in the sorted pass list accessing this texture
+            std::size_t first_use = std::numeric_limits<std::size_t>::max();
+            std::size_t last_use = 0;
+
+            // Transient texture previously placed in the same memory during this frame
+            std::optional<std::size_t> aliased_texture;
+            // Transient memory block of the graph backing the texture, shared by its aliasing group
+            std::optional<std::size_t> memory_block;
+
+            // Persistent image of a history ring, see RenderGraph::get_history_texture
+            HistoryImage* history_image = nullptr;
+
+            // Accessed on the async compute queue, excluded from aliasing as the queues are not ordered by position
+            bool async_compute_use = false;
+
+            // Attachment of a single pass or run of rendering passes that is never sampled, its contents never need to reach memory
+            bool lazily_allocated = false;
+        };
+
+        struct Buffer {
+            ResourceLifetime lifetime = ResourceLifetime::Transient;
+
+            VkBuffer buffer = VK_NULL_HANDLE;
+
             VkPipelineStageFlags2 last_stage = VK_PIPELINE_STAGE_2_NONE;
             VkAccessFlags2 last_access = VK_ACCESS_2_NONE;
 
-            VkImageLayout final_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            BufferDesc desc;
 
-            TextureDesc desc;
+            // Accessed by at least one pass that survived culling
+            bool referenced = false;
+        };
+
+        struct TransientPoolDesc {
+            // Round transient texture extents up to size buckets so resizing rarely needs new memory
+            bool bucket_extents = true;
+            // Unused transient allocations are kept alive for this many frames
+            std::uint32_t max_unused_frames = 120;
+            // Unused transient memory kept alive, least recently used allocations are freed beyond it
+            VkDeviceSize max_unused_bytes = 256ull * 1024 * 1024;
+            // By default memory is reused once the GPU has passed the frame that released it, frames keep overlapping
+            //  and every frame in flight needs its own working set.
+            //  Enabled, memory released by a frame still in flight is handed to the next frame, a single working set is shared.
+            //  The first submission on each queue then waits for the previous frame to complete,
+            //  a full stall serializing the GPU work of consecutive frames.
+            bool share_in_flight_memory = false;
         };
 
         struct TextureAllocation {
             VkImage image;
             VkImageView view;
+            // Created on demand for handles viewing part of the texture
+            std::vector<SubresourceView> subresource_views;
+        };
+
+        struct TransientMemoryBlock {
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            VkMemoryRequirements requirements = {};
+            std::uint32_t memory_type = 0;
+            // Backing transient attachments only, placed in lazily allocated memory where available
+            bool lazily_allocated = false;
+            // Images placed into the block, cached by description
+            std::map<TextureDesc, TextureAllocation> images;
+            // Frame timeline value of the last frame using the block
+            std::uint64_t release_value = 0;
+        };
+
+        // Image of a history ring, allocated on its own and kept across frames
+        struct HistoryImage {
+            TextureAllocation texture;
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            // State the last frame using the image left it in, indexed like Texture::subresource_states
+            std::vector<SubresourceState> subresource_states;
+            // Frame timeline value of the last frame writing the image, 0 if not written yet
+            std::uint64_t written_value = 0;
+        };
+
+        // Images of a history texture, advanced once per frame, the current image is written by that frame
+        struct HistoryRing {
+            TextureDesc desc;
+            std::vector<HistoryImage> images;
+            std::size_t current_image = 0;
+            // Frame timeline value of the last frame using the ring
+            std::uint64_t frame_value = 0;
+        };
+
+        struct AttachmentOps {
+            std::uint16_t texture;
+            VkAttachmentLoadOp load_op;
+            VkAttachmentStoreOp store_op;
+        };
+
+        struct ScopeAttachment {
+            TextureHandle handle;
+            VkImageLayout layout;
+            VkAttachmentLoadOp load_op;
+            VkAttachmentStoreOp store_op;
+            // Pass providing the clear value
+            std::size_t clear_position;
+            // Resolved into at the end of the scope
+            std::optional<TextureHandle> resolve_target;
+            VkResolveModeFlagBits resolve_mode = VK_RESOLVE_MODE_NONE;
+        };
+
+        // Dynamic rendering scope shared by consecutive passes with compatible attachments
+        struct RenderingScope {
+            std::size_t first_position;
+            std::size_t last_position;
+            std::vector<ScopeAttachment> color_attachments;
+            std::optional<ScopeAttachment> depth_attachment;
+        };
+
+        struct RecordingCommandPool {
+            VkCommandPool command_pool;
+            VkCommandBuffer command_buffer;
+        };
+
+        struct BufferAllocation {
+            VkBuffer buffer;
             VmaAllocation allocation;
-            std::uint32_t frames_since_use = 0;
+            BufferDesc desc;
+            // Frame timeline value of the last frame using the buffer
+            std::uint64_t release_value = 0;
         };
 
-        RenderGraph() = default;
-        RenderGraph(VkDevice device, VmaAllocator allocator);
+        // Barrier split into vkCmdSetEvent2 after the producing pass and
+        // vkCmdWaitEvents2 before the consuming pass, letting the passes in between overlap
+        struct SplitBarrier {
+            VkEvent event = VK_NULL_HANDLE;
+            std::size_t signal_position;
+            std::size_t wait_position;
+            std::vector<VkBufferMemoryBarrier2> buffer_barriers;
+            std::vector<VkImageMemoryBarrier2> image_barriers;
+            // Resource index of each barrier, used to patch handles when reusing a compiled graph
+            std::vector<std::uint16_t> buffer_barrier_buffers;
+            std::vector<std::uint16_t> image_barrier_textures;
+        };
+
+        // Synchronization recorded before the pass at the same position in the sorted pass list,
+        // the last batch is recorded after the final pass
+        struct BarrierBatch {
+            std::vector<std::size_t> signal_split_barriers;
+            std::vector<VkEvent> wait_events;
+            std::vector<VkDependencyInfo> wait_dependencies;
+            std::vector<VkBufferMemoryBarrier2> buffer_barriers;
+            std::vector<VkImageMemoryBarrier2> image_barriers;
+            std::vector<std::uint16_t> buffer_barrier_buffers;
+            std::vector<std::uint16_t> image_barrier_textures;
+        };
+
+        // Contiguous range of sorted passes running on the same queue, submitted together
+        struct QueueSegment {
+            PassQueue queue;
+            std::size_t first_position;
+            std::size_t last_position;
+            // Segment on the other queue that has to complete first
+            std::optional<std::size_t> wait_segment;
+            // Queue family ownership releases recorded at the end of the segment
+            BarrierBatch release_batch;
+        };
+
+        struct SegmentCommandPool {
+            VkCommandPool command_pool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> command_buffers;
+            std::size_t used_command_buffers = 0;
+        };
+
+        struct SubmitDesc {
+            VkQueue queue;
+            VkQueue async_compute_queue;
+            // Waited on by the first graphics submission
+            std::span<const VkSemaphoreSubmitInfo> wait_semaphores;
+            // Signalled by the last graphics submission, which completes after all work of the graph
+            std::span<const VkSemaphoreSubmitInfo> signal_semaphores;
+            // Timeline semaphore synchronizing the queues, only used by this graph
+            VkSemaphore timeline_semaphore;
+            std::uint32_t recording_threads = 1;
+        };
+
+        // Query pool receiving a begin and end timestamp for every pass, in sorted order
+        //  Multiview rendering scopes are timed as a whole and reported under their first pass.
+        struct TimestampQueryDesc {
+            VkQueryPool query_pool;
+            // Passes beyond query_count / 2 are not timed
+            std::uint32_t query_count;
+            // Nanoseconds per timestamp tick
+            float timestamp_period;
+            // Queue families without timestampValidBits cannot write timestamps
+            bool graphics_timestamps;
+            bool async_compute_timestamps;
+        };
+
+        struct PassTiming {
+            std::string_view name;
+            PassQueue queue;
+            double milliseconds;
+        };
+
+        RenderGraph();
+        RenderGraph(VkDevice device, VmaAllocator allocator, std::shared_ptr<TransientHeap> transient_heap, std::uint32_t queue_family, std::uint32_t async_compute_queue_family);
         RenderGraph(const RenderGraph&) = delete;
         RenderGraph& operator=(const RenderGraph&) = delete;
-        RenderGraph(RenderGraph&&) noexcept = default;
-        RenderGraph& operator=(RenderGraph&&) noexcept = default;
+        RenderGraph(RenderGraph&&) noexcept;
+        RenderGraph& operator=(RenderGraph&&) noexcept;
         ~RenderGraph();
 
         TextureHandle import_texture(const TextureImportDesc& desc);
         TextureHandle create_transient_texture(const TextureDesc& desc);
+        // Texture keeping its contents across frames in a ring of history_length images, e.g. the previous frame's color
+        //  Rings are identified by name and shared by the graphs of all frames, later calls have to pass the same desc
+        //  and history_length or the ring is recreated. frames_ago 0 is the image this frame writes, frames_ago i the
+        //  image written i frames before. Layouts and accesses carry over between frames, the first barrier of a frame
+        //  continues from the last access of the previous frame using the image.
+        //  Returns the same handle for the same image within a frame, keep the handles written versions are returned for.
+        TextureHandle get_history_texture(std::string_view name, const TextureDesc& desc, std::uint32_t history_length, std::uint32_t frames_ago = 0);
+        // The history image has been written by an earlier frame since its ring was created, otherwise its contents are undefined
+        bool is_history_valid(TextureHandle handle) const;
 
         const Texture& get_texture(TextureHandle handle) const;
+        VkImageView get_image_view(TextureHandle handle) const;
+        VkImageSubresourceRange get_subresource_range(TextureHandle handle) const;
+        const AttachmentOps& get_attachment_ops(std::size_t position, TextureHandle handle) const;
+
+        BufferHandle import_buffer(const BufferImportDesc& desc);
+        BufferHandle create_transient_buffer(const BufferDesc& desc);
 
-        void add_pass(std::string name, const RenderPassSetupFn auto& setup)
+        const Buffer& get_buffer(BufferHandle handle) const;
+
+        void add_pass(std::string_view name, const RenderPassSetupFn auto& setup)
         {
-            passes_.emplace_back(std::move(name));
-            auto& pass = passes_.back();
+            auto& pass = emplace_pass(name);
 
             auto builder = RenderPassBuilder{pass};
             pass.execute = setup(builder);
         }
         void compile();
-        void execute(VkCommandBuffer command_buffer);
-        void reset();
+        // Passes are recorded by up to recording_threads threads into secondary command buffers
+        //  Records everything into a single command buffer, the graph must not use async compute
+        void execute(VkCommandBuffer command_buffer, std::uint32_t recording_threads = 1);
+        // Records and submits every queue segment, synchronizing the queues with a timeline semaphore
+        void submit(const SubmitDesc& desc);
+        // Starts declaring the graph of the frame signalling frame_value on the transient heap's frame semaphore
+        void reset(std::uint64_t frame_value);
+        // Value of the frame semaphore the transient memory of this frame was last used by, submit() waits for it
+        //  Submissions of command buffers recorded with execute() have to wait for it themselves.
+        std::uint64_t get_transient_wait_value() const { return transient_wait_value_; }
+
+        // The query pool must only be used by this graph
+        void set_timestamp_queries(const TimestampQueryDesc& desc);
+        // GPU time of the passes of the previous submission, read back without waiting by reset()
+        //  Passes whose timestamps were not available yet are left out.
+        std::span<const PassTiming> get_pass_timings() const { return pass_timings_; }
+
+        // Compiled graph for review, valid between compile() and the next reset()
+        //  Passes in sorted order with the resource versions they access, every emitted barrier,
+        //  transient allocation sizes and the textures aliasing each memory block.
+        std::string to_dot() const;
+        std::string to_json() const;
 
     private:
+        RenderPass& emplace_pass(std::string_view name);
+        void compute_structure_key(std::vector<std::uint64_t>& key) const;
+        void reuse_compiled_graph();
+        void acquire_transient_allocations();
+        void release_transient_allocations(std::uint64_t frame_value);
+        void read_back_timestamps();
+        void update_history_images();
+        TextureDesc to_allocation_desc(const TextureDesc& desc) const;
+        TextureDesc to_allocation_desc(const Texture& texture) const;
+
+        void compile_build_dependencies();
+        void compile_cull_passes();
         void compile_sort_passes();
-        void compile_increment_transient_resource_last_use();
+        void compile_partition_queue_segments();
+        void compile_compute_transient_lifetimes();
+        void compile_infer_attachment_ops();
         void compile_allocate_transient_resources();
         void compile_emit_pass_barriers();
+        void compile_emit_buffer_barriers();
         void compile_emit_final_layout_transitions();
+        void compile_link_split_barriers();
+        void compile_build_rendering_scopes();
+        bool is_hoistable_resolve_target(const RenderingScope& scope, std::size_t position, std::uint16_t texture_idx) const;
+        void hoist_resolve_target_barriers(const RenderingScope& scope, std::size_t position);
+
+        VkMemoryRequirements get_memory_requirements(const TextureDesc& desc) const;
+        SplitBarrier& get_split_barrier(std::size_t signal_position, std::size_t wait_position);
+        void execute_barrier_batch(VkCommandBuffer command_buffer, const BarrierBatch& batch) const;
+        void begin_rendering_scope(VkCommandBuffer command_buffer, const RenderingScope& scope) const;
+        std::uint32_t queue_family_index(PassQueue queue) const;
+        std::uint32_t position_queue_family(std::size_t position) const;
+        std::size_t timestamp_position_end(std::size_t first_position, std::size_t last_position) const;
+        // Rendering scope of the position when it renders with multiview
+        std::optional<std::size_t> multiview_scope(std::size_t position) const;
+        void record_passes(VkCommandBuffer command_buffer, std::size_t first_position, std::size_t last_position);
+        void record_segment(VkCommandBuffer command_buffer, std::size_t segment, std::uint32_t recording_threads);
+        VkCommandBuffer begin_recording_command_buffer(std::size_t thread_idx);
+        VkCommandBuffer begin_segment_command_buffer(PassQueue queue);
 
         VkDevice vk_device_ = VK_NULL_HANDLE;
         VmaAllocator vma_allocator_ = VK_NULL_HANDLE;
+        std::uint32_t queue_family_ = 0;
+        std::uint32_t async_compute_queue_family_ = 0;
+        // Per frame declarations, passes and their lists are allocated from the frame arena
+        //  Containers keep their capacity across frames, a steady frame does not allocate.
+        std::unique_ptr<FrameArena> frame_arena_;
+        std::set<std::string, std::less<>> pass_names_;
         std::vector<Texture> textures_;
+        std::vector<Buffer> buffers_;
         std::vector<RenderPass> passes_;
         std::vector<std::size_t> sorted_passes_;
-        std::vector<VkImageMemoryBarrier2> final_layout_transitions_;
-        std::map<TextureDesc, TextureAllocation> transient_textures_;
+        std::vector<QueueSegment> segments_;
+        std::vector<std::size_t> position_segments_;
+        std::vector<BarrierBatch> barrier_batches_;
+        std::vector<SplitBarrier> split_barriers_;
+        // Load and store ops of the attachments of the pass at the same position
+        std::vector<std::vector<AttachmentOps>> attachment_ops_;
+        std::vector<RenderingScope> rendering_scopes_;
+        std::vector<std::optional<std::size_t>> position_scopes_;
+        std::vector<VkEvent> events_;
+        // One pool per recording thread, reset every frame
+        std::vector<RecordingCommandPool> recording_pools_;
+        // Threads recording pass groups besides the calling thread, kept alive across frames
+        std::unique_ptr<RecordingThreadPool> recording_threads_;
+        // Primary command buffers for queue segments, indexed by PassQueue
+        std::vector<SegmentCommandPool> segment_pools_;
+        std::optional<TimestampQueryDesc> timestamp_queries_;
+        // Timestamps were recorded for the sorted passes, results are pending until the next reset
+        bool timestamps_recorded_ = false;
+        std::vector<std::uint64_t> timestamp_results_;
+        std::vector<PassTiming> pass_timings_;
+        // Last value signalled on the timeline semaphore, values only grow across frames
+        std::uint64_t timeline_value_ = 0;
+        // Graph structure the schedule and barriers above were compiled for, reused while it does not change
+        //  Keys are kept in two buffers swapped on compile, computing them does not allocate once grown.
+        std::vector<std::uint64_t> compiled_structure_key_;
+        std::vector<std::uint64_t> structure_key_;
+        std::vector<Texture> compiled_textures_;
+        std::vector<Buffer> compiled_buffers_;
+        // Transient memory is taken from the heap for every frame and returned once the frame is submitted
+        //  Images are placed into memory blocks shared by textures with disjoint lifetimes,
+        //  the compiled graph only keeps the requirements of each block.
+        struct TransientBlock {
+            VkMemoryRequirements requirements;
+            bool lazily_allocated;
+        };
+        std::shared_ptr<TransientHeap> transient_heap_;
+        std::uint64_t frame_value_ = 0;
+        std::uint64_t transient_wait_value_ = 0;
+        std::vector<TransientBlock> transient_blocks_;
+        std::vector<TransientMemoryBlock> transient_memory_blocks_;
+        std::vector<BufferAllocation> transient_buffers_;
+    };
+
+    // Transient memory shared by the render graphs of all frames in flight
+    //  Allocations are returned tagged with the frame timeline value of the last frame using them,
+    //  and handed out again once the GPU has passed that value on the frame semaphore,
+    //  or to any later frame waiting for that value when in flight memory is shared.
+    //  The heap also owns the history rings, which have to outlive the graph of a single frame.
+    class TransientHeap
+    {
+    public:
+        TransientHeap(VkDevice device, VmaAllocator allocator, VkSemaphore frame_semaphore, const RenderGraph::TransientPoolDesc& desc = {});
+        TransientHeap(const TransientHeap&) = delete;
+        TransientHeap& operator=(const TransientHeap&) = delete;
+        ~TransientHeap();
+
+        const RenderGraph::TransientPoolDesc& desc() const { return desc_; }
+        VkSemaphore frame_semaphore() const { return frame_semaphore_; }
+
+        // Allocation for the frame signalling frame_value, its release_value is the frame the caller has to wait for
+        RenderGraph::TransientMemoryBlock acquire_memory_block(const VkMemoryRequirements& requirements, bool lazily_allocated, std::uint64_t frame_value);
+        void release_memory_block(RenderGraph::TransientMemoryBlock block, std::uint64_t frame_value);
+        const RenderGraph::TextureAllocation& get_image(RenderGraph::TransientMemoryBlock& block, const RenderGraph::TextureDesc& desc);
+        VkImageView get_image_view(RenderGraph::TransientMemoryBlock& block, const RenderGraph::TextureDesc& desc, const VkImageSubresourceRange& range);
+
+        // Ring advanced to frame_value, recreated with undefined contents if desc or history_length changed
+        RenderGraph::HistoryRing& get_history_ring(std::string_view name, const RenderGraph::TextureDesc& desc, std::uint32_t history_length, std::uint64_t frame_value);
+        VkImageView get_image_view(RenderGraph::HistoryImage& image, const RenderGraph::TextureDesc& desc, const VkImageSubresourceRange& range);
+
+        RenderGraph::BufferAllocation acquire_buffer(const RenderGraph::BufferDesc& desc, std::uint64_t frame_value);
+        void release_buffer(RenderGraph::BufferAllocation buffer, std::uint64_t frame_value);
+
+        // Frees allocations and history rings unused for too long, and allocations beyond the unused memory budget
+        void evict();
+
+    private:
+        std::uint64_t get_completed_frame_value() const;
+        bool is_reusable(std::uint64_t release_value, std::uint64_t completed_value, std::uint64_t frame_value) const;
+        VkImageView create_image_view(VkImage image, const RenderGraph::TextureDesc& desc, const VkImageSubresourceRange& range);
+        RenderGraph::TransientMemoryBlock allocate_memory_block(const VkMemoryRequirements& requirements, bool lazily_allocated);
+        void destroy_memory_block(RenderGraph::TransientMemoryBlock& block);
+        RenderGraph::HistoryImage create_history_image(const RenderGraph::TextureDesc& desc);
+        void destroy_history_ring(const RenderGraph::HistoryRing& ring);
+        RenderGraph::BufferAllocation create_buffer(const RenderGraph::BufferDesc& desc);
+        void destroy_buffer(const RenderGraph::BufferAllocation& buffer);
+
+        VkDevice vk_device_ = VK_NULL_HANDLE;
+        VmaAllocator vma_allocator_ = VK_NULL_HANDLE;
+        VkSemaphore frame_semaphore_ = VK_NULL_HANDLE;
+        RenderGraph::TransientPoolDesc desc_;
+        std::vector<RenderGraph::TransientMemoryBlock> free_memory_blocks_;
+        std::vector<RenderGraph::BufferAllocation> free_buffers_;
+        // History textures of all graphs, by name
+        std::map<std::string, RenderGraph::HistoryRing, std::less<>> history_rings_;
+        // Replaced rings, destroyed once the GPU has passed their last frame
+        std::vector<RenderGraph::HistoryRing> retired_history_rings_;
     };
 } // namespace orion
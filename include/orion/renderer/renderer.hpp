@@ -3,6 +3,7 @@
 #include <tl/expected.hpp>
 
 #include <memory>
+#include <span>
 #include <string>
 
 namespace orion
@@ -11,6 +12,13 @@ namespace orion
         const class Window& window;
     };
 
+    // GPU time of a render graph pass over the last frames it ran in
+    struct GpuPassTiming {
+        std::string name;
+        double average_milliseconds;
+        double max_milliseconds;
+    };
+
     class Renderer
     {
     public:
@@ -27,6 +35,13 @@ namespace orion
         [[nodiscard]] bool swapchain_out_of_date() const noexcept;
         tl::expected<void, std::string> recreate_swapchain(int width, int height);
 
+        // Empty if the GPU does not support timestamps on the graphics queue
+        [[nodiscard]] std::span<const GpuPassTiming> gpu_pass_timings() const noexcept;
+
+        // Writes the next compiled render graph to render_graph.dot and render_graph.json in the working directory
+        //  Also requested by pressing F12.
+        void dump_render_graph() noexcept;
+
     private:
         struct Impl;
         explicit Renderer(std::unique_ptr<Impl> impl);
@@ -0,0 +1,55 @@
+#include "orion/renderer/frame_arena.hpp"
+
+#include "orion/debug.hpp"
+
+#include <bit>
+
+namespace orion
+{
+    FrameArena::FrameArena(std::size_t capacity)
+        : buffer_(std::make_unique_for_overwrite<std::byte[]>(capacity))
+        , capacity_(capacity)
+    {
+    }
+
+    void FrameArena::reset()
+    {
+        // Grow once so the next frame of the same size fits into the buffer
+        if (!overflow_blocks_.empty()) {
+            capacity_ = std::bit_ceil(capacity_ + overflow_bytes_);
+            buffer_ = std::make_unique_for_overwrite<std::byte[]>(capacity_);
+            overflow_blocks_.clear();
+            overflow_bytes_ = 0;
+        }
+        offset_ = 0;
+    }
+
+    void* FrameArena::do_allocate(std::size_t bytes, std::size_t alignment)
+    {
+        void* ptr = buffer_.get() + offset_;
+        auto space = capacity_ - offset_;
+        if (std::align(alignment, bytes, ptr, space)) {
+            offset_ = capacity_ - space + bytes;
+            return ptr;
+        }
+
+        // Out of space for this frame, over-allocate to align within the block
+        auto& block = overflow_blocks_.emplace_back(std::make_unique_for_overwrite<std::byte[]>(bytes + alignment));
+        overflow_bytes_ += bytes + alignment;
+        ptr = block.get();
+        space = bytes + alignment;
+        ptr = std::align(alignment, bytes, ptr, space);
+        ORION_ASSERT(ptr != nullptr);
+        return ptr;
+    }
+
+    void FrameArena::do_deallocate(void*, std::size_t, std::size_t)
+    {
+        // Freed all at once by reset()
+    }
+
+    bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+    {
+        return this == &other;
+    }
+} // namespace orion
@@ -54,7 +54,7 @@ namespace orion
                     .viewMask = 0,
                     .colorAttachmentCount = 1,
                     .pColorAttachmentFormats = &desc.vulkan_swapchain.image_format,
-                    .depthAttachmentFormat = VK_FORMAT_UNDEFINED,
+                    .depthAttachmentFormat = desc.depth_format,
                     .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
                 },
             },
@@ -12,6 +12,8 @@ namespace orion
         const class Window& window;
         const VulkanDevice& vulkan_device;
         const VulkanSwapchain& vulkan_swapchain;
+        // Depth attachment the pass drawing ImGui declares, the pipeline has to match its rendering scope
+        VkFormat depth_format;
     };
 
     class ImGuiContextWrapper
@@ -6,7 +6,18 @@
 
 #include <vulkan/vk_enum_string_helper.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
 #include <utility>
 
 namespace orion
@@ -24,19 +35,124 @@ namespace orion
         unreachable();
     }
 
-    void load_shader(const ShaderPath& shader, std::vector<std::uint32_t>& code, VkShaderModuleCreateInfo& shader_info)
+    // "ORPC", the file header of our pipeline cache files
+    static constexpr std::uint32_t cache_file_magic = 0x4350524f;
+    // Bumped when the file header changes
+    static constexpr std::uint32_t cache_file_version = 1;
+
+    // FNV-1a, guards the cache data against truncated and damaged files
+    //  Continues from a previous hash to combine several ranges into one.
+    static std::uint64_t hash_bytes(std::span<const std::byte> bytes, std::uint64_t hash = 0xcbf29ce484222325ull)
+    {
+        for (auto byte : bytes) {
+            hash = (hash ^ static_cast<std::uint64_t>(byte)) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // Only for types without padding, their bytes are appended as is
+    template<typename T>
+    static void append_values(PipelineStateKey& key, std::span<const T> values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto bytes = std::as_bytes(values);
+        key.insert(key.end(), bytes.begin(), bytes.end());
+    }
+
+    template<typename T>
+    static void append_value(PipelineStateKey& key, const T& value)
+    {
+        append_values(key, std::span(&value, 1));
+    }
+
+    std::size_t PipelineStateHash::operator()(const PipelineStateKey& key) const
+    {
+        return static_cast<std::size_t>(hash_bytes(key));
+    }
+
+    ShaderModuleCache::ShaderModuleCache(VkDevice device, bool use_identifiers)
+        : vk_device_(device)
+        , use_identifiers_(use_identifiers)
+    {
+    }
+
+    ShaderModuleCache::~ShaderModuleCache()
     {
+        for (const auto& [_, shader] : shaders_) {
+            if (shader.module != VK_NULL_HANDLE) {
+                vkDestroyShaderModule(vk_device_, shader.module, nullptr);
+                ORION_RENDERER_LOG_INFO("Destroyed VkShaderModule {}", fmt::ptr(shader.module));
+            }
+        }
+    }
+
+    ShaderModule& ShaderModuleCache::load(const ShaderPath& shader)
+    {
+        auto lock = std::scoped_lock{mutex_};
+        auto path = shader.string();
+        if (auto it = shader_hashes_.find(path); it != shader_hashes_.end()) {
+            return shaders_.at(it->second);
+        }
+
         auto file = std::ifstream{shader, std::ios::binary};
         ORION_ASSERT(file.good());
         const auto length = std::filesystem::file_size(shader);
-        code.resize(length / sizeof(std::uint32_t));
+        auto code = std::vector<std::uint32_t>(length / sizeof(std::uint32_t));
         file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(length));
-        shader_info.codeSize = length;
-        shader_info.pCode = reinterpret_cast<std::uint32_t*>(code.data());
+        const auto hash = hash_bytes(std::as_bytes(std::span(code)));
+
+        // Same code under another path shares the module, a hash collision probes the next key
+        auto key = hash;
+        for (auto it = shaders_.find(key); it != shaders_.end(); it = shaders_.find(++key)) {
+            if (it->second.code == code) {
+                shader_hashes_.emplace(std::move(path), key);
+                return it->second;
+            }
+        }
+        shader_hashes_.emplace(std::move(path), key);
+
+        auto& module = shaders_[key];
+        module.code = std::move(code);
+        module.hash = hash;
+        module.identifier = {.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_IDENTIFIER_EXT};
+        if (use_identifiers_) {
+            // The identifier only depends on the code, no module needs to exist for it
+            const auto module_info = VkShaderModuleCreateInfo{
+                .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = {},
+                .codeSize = module.code.size() * sizeof(std::uint32_t),
+                .pCode = module.code.data(),
+            };
+            vkGetShaderModuleCreateInfoIdentifierEXT(vk_device_, &module_info, &module.identifier);
+        }
+        return module;
     }
 
-    PipelineBuilder::PipelineBuilder(VkPipelineLayout layout)
-        : shader_stages_({
+    tl::expected<VkShaderModule, VkResult> ShaderModuleCache::get_module(ShaderModule& shader)
+    {
+        auto lock = std::scoped_lock{mutex_};
+        if (shader.module != VK_NULL_HANDLE) {
+            return shader.module;
+        }
+        const auto module_info = VkShaderModuleCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = {},
+            .codeSize = shader.code.size() * sizeof(std::uint32_t),
+            .pCode = shader.code.data(),
+        };
+        if (VkResult err = vkCreateShaderModule(vk_device_, &module_info, nullptr, &shader.module)) {
+            ORION_RENDERER_LOG_ERROR("vkCreateShaderModule() failed: {}", string_VkResult(err));
+            return tl::unexpected(err);
+        }
+        ORION_RENDERER_LOG_INFO("Created VkShaderModule {}", fmt::ptr(shader.module));
+        return shader.module;
+    }
+
+    PipelineBuilder::PipelineBuilder(VkPipelineLayout layout, ShaderModuleCache& shader_modules)
+        : shader_modules_(&shader_modules)
+        , shader_stages_({
               VkPipelineShaderStageCreateInfo{
                   .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
                   .stage = VK_SHADER_STAGE_VERTEX_BIT,
@@ -48,8 +164,6 @@ namespace orion
                   .pName = "main",
               },
           })
-        , vs_info_({.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO})
-        , fs_info_({.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO})
         , rendering_state_{
               .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
               .viewMask = 0,
@@ -109,17 +223,39 @@ namespace orion
               .pDynamicStates = dynamic_states.data(),
           }
         , layout_(layout)
+        , library_infos_({
+              VkGraphicsPipelineLibraryCreateInfoEXT{
+                  .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+                  .pNext = nullptr,
+                  .flags = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+              },
+              VkGraphicsPipelineLibraryCreateInfoEXT{
+                  .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+                  .pNext = &rendering_state_,
+                  .flags = VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+              },
+              VkGraphicsPipelineLibraryCreateInfoEXT{
+                  .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+                  .pNext = &rendering_state_,
+                  .flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+              },
+              VkGraphicsPipelineLibraryCreateInfoEXT{
+                  .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+                  .pNext = &rendering_state_,
+                  .flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+              },
+          })
     {
     }
 
     void PipelineBuilder::set_vertex_shader(const ShaderPath& shader)
     {
-        load_shader(std::filesystem::path(ORION_BINARY_DIR) / shader, vs_code_, vs_info_);
+        stage_shaders_[0] = &shader_modules_->load(std::filesystem::path(ORION_BINARY_DIR) / shader);
     }
 
     void PipelineBuilder::set_fragment_shader(const ShaderPath& shader)
     {
-        load_shader(std::filesystem::path(ORION_BINARY_DIR) / shader, fs_code_, fs_info_);
+        stage_shaders_[1] = &shader_modules_->load(std::filesystem::path(ORION_BINARY_DIR) / shader);
     }
 
     void PipelineBuilder::add_vertex_binding(std::uint32_t binding, std::uint32_t stride, VkVertexInputRate input_rate)
@@ -166,6 +302,11 @@ namespace orion
         rasterization_state_.frontFace = front_face;
     }
 
+    void PipelineBuilder::set_sample_count(VkSampleCountFlagBits samples)
+    {
+        multisample_state_.rasterizationSamples = samples;
+    }
+
     void PipelineBuilder::add_color_attachment(VkFormat format, BlendMode blend_mode)
     {
         color_attachments_.push_back(format);
@@ -182,23 +323,193 @@ namespace orion
         rendering_state_.depthAttachmentFormat = format;
     }
 
-    tl::expected<VkPipeline, VkResult> PipelineBuilder::build(VkDevice device)
+    void PipelineBuilder::set_view_mask(std::uint32_t view_mask)
     {
-        // Create shader modules
-        if (VkResult err = vkCreateShaderModule(device, &vs_info_, nullptr, &shader_stages_[0].module)) {
-            ORION_RENDERER_LOG_ERROR("vkCreateShaderModule() failed: {}", string_VkResult(err));
-            return tl::unexpected(err);
+        rendering_state_.viewMask = view_mask;
+    }
+
+    PipelineStateKey PipelineBuilder::state_key() const
+    {
+        auto key = PipelineStateKey{};
+        for (std::size_t part_idx = 0; part_idx < pipeline_part_count; ++part_idx) {
+            append_state_key(static_cast<PipelinePart>(part_idx), key);
         }
-        if (VkResult err = vkCreateShaderModule(device, &fs_info_, nullptr, &shader_stages_[1].module)) {
-            ORION_RENDERER_LOG_ERROR("vkCreateShaderModule() failed: {}", string_VkResult(err));
-            vkDestroyShaderModule(device, shader_stages_[0].module, nullptr);
-            return tl::unexpected(err);
+        return key;
+    }
+
+    PipelineStateKey PipelineBuilder::state_key(PipelinePart part) const
+    {
+        auto key = PipelineStateKey{};
+        append_state_key(part, key);
+        return key;
+    }
+
+    std::uint64_t PipelineBuilder::hash() const
+    {
+        return hash_bytes(state_key());
+    }
+
+    void PipelineBuilder::append_state_key(PipelinePart part, PipelineStateKey& key) const
+    {
+        // Appended field by field, the create infos contain pointers and padding
+        //  Variable length state is preceded by its length so keys of different state never match.
+        //  Shaders are identified by their ShaderModule, the cache keeps one per distinct code.
+        append_value(key, part);
+        switch (part) {
+            case PipelinePart::VertexInput:
+                append_value(key, vertex_bindings_.size());
+                append_values(key, std::span(vertex_bindings_));
+                append_value(key, vertex_attributes_.size());
+                append_values(key, std::span(vertex_attributes_));
+                append_value(key, input_assembly_state_.topology);
+                append_value(key, input_assembly_state_.primitiveRestartEnable);
+                return;
+            case PipelinePart::PreRasterization:
+                append_value(key, stage_shaders_[0]);
+                append_value(key, rendering_state_.viewMask);
+                append_value(key, viewport_state_.viewportCount);
+                append_value(key, viewport_state_.scissorCount);
+                append_value(key, rasterization_state_.depthClampEnable);
+                append_value(key, rasterization_state_.rasterizerDiscardEnable);
+                append_value(key, rasterization_state_.polygonMode);
+                append_value(key, rasterization_state_.cullMode);
+                append_value(key, rasterization_state_.frontFace);
+                append_value(key, rasterization_state_.depthBiasEnable);
+                append_value(key, rasterization_state_.depthBiasConstantFactor);
+                append_value(key, rasterization_state_.depthBiasClamp);
+                append_value(key, rasterization_state_.depthBiasSlopeFactor);
+                append_value(key, rasterization_state_.lineWidth);
+                append_value(key, layout_);
+                return;
+            case PipelinePart::FragmentShader:
+                append_value(key, stage_shaders_[1]);
+                append_value(key, rendering_state_.viewMask);
+                append_value(key, multisample_state_.rasterizationSamples);
+                append_value(key, multisample_state_.sampleShadingEnable);
+                append_value(key, multisample_state_.minSampleShading);
+                append_value(key, depth_stencil_state_.depthTestEnable);
+                append_value(key, depth_stencil_state_.depthWriteEnable);
+                append_value(key, depth_stencil_state_.depthCompareOp);
+                append_value(key, depth_stencil_state_.depthBoundsTestEnable);
+                append_value(key, depth_stencil_state_.stencilTestEnable);
+                append_value(key, depth_stencil_state_.front);
+                append_value(key, depth_stencil_state_.back);
+                append_value(key, depth_stencil_state_.minDepthBounds);
+                append_value(key, depth_stencil_state_.maxDepthBounds);
+                append_value(key, layout_);
+                return;
+            case PipelinePart::FragmentOutput:
+                append_value(key, rendering_state_.viewMask);
+                append_value(key, color_attachments_.size());
+                append_values(key, std::span(color_attachments_));
+                append_value(key, rendering_state_.depthAttachmentFormat);
+                append_value(key, rendering_state_.stencilAttachmentFormat);
+                append_value(key, multisample_state_.rasterizationSamples);
+                append_value(key, multisample_state_.alphaToCoverageEnable);
+                append_value(key, multisample_state_.alphaToOneEnable);
+                append_value(key, color_blend_state_.logicOpEnable);
+                append_value(key, color_blend_state_.logicOp);
+                append_value(key, blend_attachments_.size());
+                append_values(key, std::span(blend_attachments_));
+                append_value(key, color_blend_state_.blendConstants);
+                return;
         }
+        ORION_ASSERT(false);
+    }
 
-        // Create pipeline
-        const auto pipeline_info = VkGraphicsPipelineCreateInfo{
+    tl::expected<VkPipeline, VkResult> PipelineBuilder::build(VkDevice device, VkPipelineCache pipeline_cache)
+    {
+        auto* builder = this;
+        return std::move(build_batch(device, pipeline_cache, std::span(&builder, 1))[0]);
+    }
+
+    std::vector<tl::expected<VkPipeline, VkResult>> PipelineBuilder::build_batch(VkDevice device, VkPipelineCache pipeline_cache, std::span<PipelineBuilder* const> builders)
+    {
+        auto results = std::vector<tl::expected<VkPipeline, VkResult>>(builders.size(), tl::unexpected(VK_ERROR_UNKNOWN));
+        auto indices = std::vector<std::size_t>(builders.size());
+        std::iota(indices.begin(), indices.end(), std::size_t{0});
+
+        // Pipelines found in the pipeline cache skip shader module creation altogether
+        const bool use_identifiers = !builders.empty() && builders.front()->shader_modules_->uses_identifiers();
+        if (use_identifiers) {
+            indices = create_pipelines(device, pipeline_cache, builders, indices, true, results);
+        }
+        if (!indices.empty()) {
+            create_pipelines(device, pipeline_cache, builders, indices, false, results);
+        }
+        return results;
+    }
+
+    std::vector<std::size_t> PipelineBuilder::create_pipelines(VkDevice device, VkPipelineCache pipeline_cache, std::span<PipelineBuilder* const> builders,
+                                                               std::span<const std::size_t> indices, bool use_identifiers,
+                                                               std::span<tl::expected<VkPipeline, VkResult>> results)
+    {
+        // Builders whose shader modules failed are left out of the call
+        const VkPipelineCreateFlags flags = use_identifiers ? VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT : 0;
+        auto created = std::vector<std::size_t>{};
+        auto pipeline_infos = std::vector<VkGraphicsPipelineCreateInfo>{};
+        for (auto index : indices) {
+            if (auto stages = builders[index]->set_stage_shaders(use_identifiers); !stages) {
+                results[index] = tl::unexpected(stages.error());
+                continue;
+            }
+            created.push_back(index);
+            pipeline_infos.push_back(builders[index]->to_create_info(flags));
+        }
+        if (created.empty()) {
+            return {};
+        }
+
+        // Pipelines that were created stay valid when others in the call fail
+        auto pipelines = std::vector<VkPipeline>(created.size(), VK_NULL_HANDLE);
+        VkResult err = vkCreateGraphicsPipelines(device, pipeline_cache, static_cast<std::uint32_t>(pipeline_infos.size()), pipeline_infos.data(), nullptr, pipelines.data());
+        if (err && err != VK_PIPELINE_COMPILE_REQUIRED) {
+            ORION_RENDERER_LOG_ERROR("vkCreateGraphicsPipelines() failed: {}", string_VkResult(err));
+        }
+        auto missing = std::vector<std::size_t>{};
+        for (std::size_t i = 0; i < created.size(); ++i) {
+            if (pipelines[i] != VK_NULL_HANDLE) {
+                results[created[i]] = pipelines[i];
+            } else if (use_identifiers) {
+                missing.push_back(created[i]);
+            } else {
+                results[created[i]] = tl::unexpected(err != VK_SUCCESS ? err : VK_ERROR_UNKNOWN);
+            }
+        }
+        return missing;
+    }
+
+    tl::expected<void, VkResult> PipelineBuilder::set_stage_shaders(bool use_identifiers)
+    {
+        for (std::size_t stage_idx = 0; stage_idx < shader_stages_.size(); ++stage_idx) {
+            auto& stage = shader_stages_[stage_idx];
+            auto* shader = stage_shaders_[stage_idx];
+            ORION_ASSERT(shader != nullptr);
+            if (use_identifiers) {
+                stage_identifiers_[stage_idx] = {
+                    .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_MODULE_IDENTIFIER_CREATE_INFO_EXT,
+                    .pNext = nullptr,
+                    .identifierSize = shader->identifier.identifierSize,
+                    .pIdentifier = shader->identifier.identifier,
+                };
+                stage.pNext = &stage_identifiers_[stage_idx];
+                stage.module = VK_NULL_HANDLE;
+            } else if (auto module = shader_modules_->get_module(*shader)) {
+                stage.pNext = nullptr;
+                stage.module = *module;
+            } else {
+                return tl::unexpected(module.error());
+            }
+        }
+        return {};
+    }
+
+    VkGraphicsPipelineCreateInfo PipelineBuilder::to_create_info(VkPipelineCreateFlags flags) const
+    {
+        return {
             .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
             .pNext = &rendering_state_,
+            .flags = flags,
             .stageCount = static_cast<std::uint32_t>(shader_stages_.size()),
             .pStages = shader_stages_.data(),
             .pVertexInputState = &vertex_input_state_,
@@ -216,54 +527,416 @@ namespace orion
             .basePipelineHandle = VK_NULL_HANDLE,
             .basePipelineIndex = 0,
         };
+    }
+
+    VkGraphicsPipelineCreateInfo PipelineBuilder::to_library_create_info(PipelinePart part) const
+    {
+        auto pipeline_info = VkGraphicsPipelineCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+            .pNext = &library_infos_[static_cast<std::size_t>(part)],
+            .flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT,
+            .stageCount = 0,
+            .pStages = nullptr,
+            .pVertexInputState = nullptr,
+            .pInputAssemblyState = nullptr,
+            .pTessellationState = nullptr,
+            .pViewportState = nullptr,
+            .pRasterizationState = nullptr,
+            .pMultisampleState = nullptr,
+            .pDepthStencilState = nullptr,
+            .pColorBlendState = nullptr,
+            .pDynamicState = nullptr,
+            .layout = VK_NULL_HANDLE,
+            .renderPass = VK_NULL_HANDLE,
+            .subpass = 0,
+            .basePipelineHandle = VK_NULL_HANDLE,
+            .basePipelineIndex = 0,
+        };
+        switch (part) {
+            case PipelinePart::VertexInput:
+                pipeline_info.pVertexInputState = &vertex_input_state_;
+                pipeline_info.pInputAssemblyState = &input_assembly_state_;
+                break;
+            case PipelinePart::PreRasterization:
+                pipeline_info.stageCount = 1;
+                pipeline_info.pStages = &shader_stages_[0];
+                pipeline_info.pViewportState = &viewport_state_;
+                pipeline_info.pRasterizationState = &rasterization_state_;
+                pipeline_info.pDynamicState = &dynamic_state_;
+                pipeline_info.layout = layout_;
+                break;
+            case PipelinePart::FragmentShader:
+                pipeline_info.stageCount = 1;
+                pipeline_info.pStages = &shader_stages_[1];
+                pipeline_info.pMultisampleState = &multisample_state_;
+                pipeline_info.pDepthStencilState = &depth_stencil_state_;
+                pipeline_info.layout = layout_;
+                break;
+            case PipelinePart::FragmentOutput:
+                pipeline_info.pMultisampleState = &multisample_state_;
+                pipeline_info.pColorBlendState = &color_blend_state_;
+                break;
+        }
+        return pipeline_info;
+    }
+
+    PipelineLibraryCache::PipelineLibraryCache(VkDevice device, VkPipelineCache pipeline_cache, VkPipelineLayout pipeline_layout)
+        : vk_device_(device)
+        , vk_pipeline_cache_(pipeline_cache)
+        , pipeline_layout_(pipeline_layout)
+    {
+    }
+
+    PipelineLibraryCache::~PipelineLibraryCache()
+    {
+        for (const auto& retired : retired_pipelines_) {
+            vkDestroyPipeline(vk_device_, retired.pipeline, nullptr);
+            ORION_RENDERER_LOG_INFO("Destroyed VkPipeline {}", fmt::ptr(retired.pipeline));
+        }
+        for (const auto& [_, library] : libraries_) {
+            vkDestroyPipeline(vk_device_, library, nullptr);
+            ORION_RENDERER_LOG_INFO("Destroyed VkPipeline (library) {}", fmt::ptr(library));
+        }
+    }
+
+    tl::expected<PipelineLibraries, VkResult> PipelineLibraryCache::get_libraries(PipelineBuilder& builder)
+    {
+        auto libraries = PipelineLibraries{};
+        auto keys = std::array<PipelineStateKey, pipeline_part_count>{};
+        auto missing_parts = std::vector<std::size_t>{};
+        {
+            auto lock = std::scoped_lock{mutex_};
+            for (std::size_t part_idx = 0; part_idx < pipeline_part_count; ++part_idx) {
+                keys[part_idx] = builder.state_key(static_cast<PipelinePart>(part_idx));
+                if (auto it = libraries_.find(keys[part_idx]); it != libraries_.end()) {
+                    libraries[part_idx] = it->second;
+                } else {
+                    missing_parts.push_back(part_idx);
+                }
+            }
+        }
+        if (missing_parts.empty()) {
+            return libraries;
+        }
+
+        // Compiled without holding the lock, compile threads may create the same part meanwhile
+        if (auto stages = builder.set_stage_shaders(false); !stages) {
+            return tl::unexpected(stages.error());
+        }
+        auto library_infos = std::vector<VkGraphicsPipelineCreateInfo>{};
+        for (auto part_idx : missing_parts) {
+            library_infos.push_back(builder.to_library_create_info(static_cast<PipelinePart>(part_idx)));
+        }
+        auto created = std::vector<VkPipeline>(missing_parts.size(), VK_NULL_HANDLE);
+        if (VkResult err = vkCreateGraphicsPipelines(vk_device_, vk_pipeline_cache_, static_cast<std::uint32_t>(library_infos.size()), library_infos.data(), nullptr, created.data())) {
+            ORION_RENDERER_LOG_ERROR("vkCreateGraphicsPipelines() failed: {}", string_VkResult(err));
+            for (VkPipeline library : created) {
+                vkDestroyPipeline(vk_device_, library, nullptr);
+            }
+            return tl::unexpected(err);
+        }
+
+        auto lock = std::scoped_lock{mutex_};
+        for (std::size_t i = 0; i < missing_parts.size(); ++i) {
+            const auto part_idx = missing_parts[i];
+            auto [it, inserted] = libraries_.try_emplace(std::move(keys[part_idx]), created[i]);
+            if (inserted) {
+                ORION_RENDERER_LOG_INFO("Created VkPipeline (library) {}", fmt::ptr(created[i]));
+            } else {
+                vkDestroyPipeline(vk_device_, created[i], nullptr);
+            }
+            libraries[part_idx] = it->second;
+        }
+        return libraries;
+    }
+
+    tl::expected<VkPipeline, VkResult> PipelineLibraryCache::link(const PipelineLibraries& libraries, bool link_time_optimize) const
+    {
+        const auto library_info = VkPipelineLibraryCreateInfoKHR{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+            .pNext = nullptr,
+            .libraryCount = static_cast<std::uint32_t>(libraries.size()),
+            .pLibraries = libraries.data(),
+        };
+        const auto pipeline_info = VkGraphicsPipelineCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+            .pNext = &library_info,
+            .flags = link_time_optimize ? VkPipelineCreateFlags{VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT} : VkPipelineCreateFlags{0},
+            .stageCount = 0,
+            .pStages = nullptr,
+            .pVertexInputState = nullptr,
+            .pInputAssemblyState = nullptr,
+            .pTessellationState = nullptr,
+            .pViewportState = nullptr,
+            .pRasterizationState = nullptr,
+            .pMultisampleState = nullptr,
+            .pDepthStencilState = nullptr,
+            .pColorBlendState = nullptr,
+            .pDynamicState = nullptr,
+            .layout = pipeline_layout_,
+            .renderPass = VK_NULL_HANDLE,
+            .subpass = 0,
+            .basePipelineHandle = VK_NULL_HANDLE,
+            .basePipelineIndex = 0,
+        };
         VkPipeline pipeline = VK_NULL_HANDLE;
-        VkResult err = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline);
-        vkDestroyShaderModule(device, shader_stages_[1].module, nullptr);
-        vkDestroyShaderModule(device, shader_stages_[0].module, nullptr);
-        if (err) {
+        if (VkResult err = vkCreateGraphicsPipelines(vk_device_, vk_pipeline_cache_, 1, &pipeline_info, nullptr, &pipeline)) {
             ORION_RENDERER_LOG_ERROR("vkCreateGraphicsPipelines() failed: {}", string_VkResult(err));
             return tl::unexpected(err);
-        } else {
-            return pipeline;
         }
+        return pipeline;
     }
 
-    PipelineCache::PipelineCache(VkDevice device, VkPipelineLayout pipeline_layout)
-        : vk_device_(device)
+    void PipelineLibraryCache::retire(VkPipeline pipeline)
+    {
+        auto lock = std::scoped_lock{mutex_};
+        retired_pipelines_.push_back({.pipeline = pipeline});
+    }
+
+    void PipelineLibraryCache::destroy_retired(std::uint64_t frame_value, std::uint64_t completed_value)
+    {
+        auto lock = std::scoped_lock{mutex_};
+        std::erase_if(retired_pipelines_, [&](RetiredPipeline& retired) {
+            if (retired.frame_value == UINT64_MAX) {
+                retired.frame_value = frame_value;
+            }
+            if (retired.frame_value > completed_value) {
+                return false;
+            }
+            vkDestroyPipeline(vk_device_, retired.pipeline, nullptr);
+            ORION_RENDERER_LOG_INFO("Destroyed VkPipeline {}", fmt::ptr(retired.pipeline));
+            return true;
+        });
+    }
+
+    // Compiles queued pipelines on worker threads
+    //  A worker takes up to max_batch_size queued pipelines at once and creates them with one vkCreateGraphicsPipelines() call.
+    //  With pipeline libraries pipelines are fast linked instead, their optimized link is queued behind the pipelines still waiting.
+    class PipelineCompiler
+    {
+    public:
+        static constexpr std::size_t max_batch_size = 8;
+
+        struct Job {
+            std::string name;
+            // Without a builder the libraries are linked with link time optimization, replacing the fast linked pipeline
+            std::unique_ptr<PipelineBuilder> builder;
+            PipelineLibraries libraries = {};
+            // Entry in the pipeline cache, published once the pipeline is created
+            std::atomic<VkPipeline>* pipeline;
+            std::promise<tl::expected<void, VkResult>> promise;
+        };
+
+        PipelineCompiler(VkDevice device, VkPipelineCache pipeline_cache, PipelineLibraryCache* libraries, std::size_t worker_count)
+            : vk_device_(device)
+            , vk_pipeline_cache_(pipeline_cache)
+            , libraries_(libraries)
+        {
+            workers_.reserve(worker_count);
+            for (std::size_t worker_idx = 0; worker_idx < worker_count; ++worker_idx) {
+                workers_.emplace_back([this](std::stop_token stop_token) { work(stop_token); });
+            }
+        }
+        PipelineCompiler(const PipelineCompiler&) = delete;
+        PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+        ~PipelineCompiler()
+        {
+            // Queued pipelines are dropped, their futures report std::future_errc::broken_promise
+            //  Workers only finish the batch they already took, optimized links they queue meanwhile are dropped as well.
+            for (auto& worker : workers_) {
+                worker.request_stop();
+            }
+            auto lock = std::scoped_lock{mutex_};
+            jobs_.clear();
+        }
+
+        void push(Job job)
+        {
+            {
+                auto lock = std::scoped_lock{mutex_};
+                jobs_.push_back(std::move(job));
+                ++pending_jobs_;
+            }
+            start_.notify_one();
+        }
+
+        void wait_idle()
+        {
+            auto lock = std::unique_lock{mutex_};
+            idle_.wait(lock, [this] { return pending_jobs_ == 0; });
+        }
+
+    private:
+        void work(std::stop_token stop_token)
+        {
+            auto batch = std::vector<Job>{};
+            auto lock = std::unique_lock{mutex_};
+            // The wait also returns true on a stop request while jobs are queued, those are left to the destructor
+            while (start_.wait(lock, stop_token, [this] { return !jobs_.empty(); }) && !stop_token.stop_requested()) {
+                const auto batch_size = std::min(jobs_.size(), max_batch_size);
+                std::move(jobs_.begin(), jobs_.begin() + static_cast<std::ptrdiff_t>(batch_size), std::back_inserter(batch));
+                jobs_.erase(jobs_.begin(), jobs_.begin() + static_cast<std::ptrdiff_t>(batch_size));
+                lock.unlock();
+                compile(batch);
+                batch.clear();
+                lock.lock();
+                pending_jobs_ -= batch_size;
+                if (pending_jobs_ == 0) {
+                    idle_.notify_all();
+                }
+            }
+        }
+
+        void compile(std::vector<Job>& batch)
+        {
+            if (libraries_ != nullptr) {
+                for (auto& job : batch) {
+                    if (job.builder != nullptr) {
+                        fast_link(job);
+                    } else {
+                        optimize(job);
+                    }
+                }
+                return;
+            }
+
+            auto builders = std::vector<PipelineBuilder*>{};
+            builders.reserve(batch.size());
+            for (const auto& job : batch) {
+                builders.push_back(job.builder.get());
+            }
+            auto pipelines = PipelineBuilder::build_batch(vk_device_, vk_pipeline_cache_, builders);
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                auto& job = batch[i];
+                if (!pipelines[i]) {
+                    job.promise.set_value(tl::unexpected(pipelines[i].error()));
+                    continue;
+                }
+                ORION_RENDERER_LOG_INFO("Created VkPipeline (graphics) {} ({})", fmt::ptr(*pipelines[i]), job.name);
+                job.pipeline->store(*pipelines[i], std::memory_order_release);
+                job.promise.set_value({});
+            }
+        }
+
+        void fast_link(Job& job)
+        {
+            auto libraries = libraries_->get_libraries(*job.builder);
+            if (!libraries) {
+                job.promise.set_value(tl::unexpected(libraries.error()));
+                return;
+            }
+            auto pipeline = libraries_->link(*libraries, false);
+            if (!pipeline) {
+                job.promise.set_value(tl::unexpected(pipeline.error()));
+                return;
+            }
+            ORION_RENDERER_LOG_INFO("Created VkPipeline (graphics, fast linked) {} ({})", fmt::ptr(*pipeline), job.name);
+            job.pipeline->store(*pipeline, std::memory_order_release);
+            push({
+                .name = std::move(job.name),
+                .builder = nullptr,
+                .libraries = *libraries,
+                .pipeline = job.pipeline,
+                .promise = {},
+            });
+            job.promise.set_value({});
+        }
+
+        void optimize(const Job& job) const
+        {
+            // The fast linked pipeline stays in use when the optimized link fails
+            auto pipeline = libraries_->link(job.libraries, true);
+            if (!pipeline) {
+                return;
+            }
+            ORION_RENDERER_LOG_INFO("Created VkPipeline (graphics, link time optimized) {} ({})", fmt::ptr(*pipeline), job.name);
+            libraries_->retire(job.pipeline->exchange(*pipeline, std::memory_order_acq_rel));
+        }
+
+        VkDevice vk_device_;
+        VkPipelineCache vk_pipeline_cache_;
+        PipelineLibraryCache* libraries_;
+
+        std::mutex mutex_;
+        std::condition_variable_any start_;
+        std::condition_variable idle_;
+        std::deque<Job> jobs_;
+        std::size_t pending_jobs_ = 0;
+        // Last member, workers are joined before the state they wait on is destroyed
+        std::vector<std::jthread> workers_;
+    };
+
+    PipelineCache::PipelineCache(const PipelineCacheDesc& desc, VkPipelineLayout pipeline_layout, VkPipelineCache vk_pipeline_cache, const FileHeader& file_header)
+        : vk_device_(desc.device)
         , pipeline_layout_(pipeline_layout)
+        , vk_pipeline_cache_(vk_pipeline_cache)
+        , file_header_(file_header)
+        , cache_file_(desc.cache_file)
+        , shader_modules_(std::make_unique<ShaderModuleCache>(desc.device, desc.shader_module_identifiers))
+        , libraries_(desc.graphics_pipeline_library ? std::make_unique<PipelineLibraryCache>(desc.device, vk_pipeline_cache, pipeline_layout) : nullptr)
+        , compiler_(std::make_unique<PipelineCompiler>(desc.device, vk_pipeline_cache, libraries_.get(), desc.compile_threads))
     {
     }
 
     PipelineCache::PipelineCache(PipelineCache&& other) noexcept
         : vk_device_(other.vk_device_)
         , pipeline_layout_(std::exchange(other.pipeline_layout_, VK_NULL_HANDLE))
+        , vk_pipeline_cache_(std::exchange(other.vk_pipeline_cache_, VK_NULL_HANDLE))
+        , file_header_(other.file_header_)
+        , cache_file_(std::move(other.cache_file_))
+        , saved_size_(other.saved_size_)
+        , shader_modules_(std::move(other.shader_modules_))
+        , libraries_(std::move(other.libraries_))
         , pipelines_(std::move(other.pipelines_))
+        , pipeline_ids_(std::move(other.pipeline_ids_))
+        , pipeline_names_(std::move(other.pipeline_names_))
+        , compiler_(std::move(other.compiler_))
     {
     }
 
     PipelineCache& PipelineCache::operator=(PipelineCache&& other) noexcept
     {
         if (this != &other) {
-            for (const auto& [_, pipeline] : pipelines_) {
-                vkDestroyPipeline(vk_device_, pipeline, nullptr);
-                ORION_RENDERER_LOG_INFO("Destroyed VkPipeline {}", fmt::ptr(pipeline));
-            }
-            if (pipeline_layout_ != VK_NULL_HANDLE) {
-                vkDestroyPipelineLayout(vk_device_, pipeline_layout_, nullptr);
-                ORION_RENDERER_LOG_INFO("Destroyed VkPipelineLayout {}", fmt::ptr(pipeline_layout_));
-            }
+            destroy();
             vk_device_ = other.vk_device_;
             pipeline_layout_ = std::exchange(other.pipeline_layout_, VK_NULL_HANDLE);
+            vk_pipeline_cache_ = std::exchange(other.vk_pipeline_cache_, VK_NULL_HANDLE);
+            file_header_ = other.file_header_;
+            cache_file_ = std::move(other.cache_file_);
+            saved_size_ = other.saved_size_;
+            shader_modules_ = std::move(other.shader_modules_);
+            libraries_ = std::move(other.libraries_);
             pipelines_ = std::move(other.pipelines_);
+            pipeline_ids_ = std::move(other.pipeline_ids_);
+            pipeline_names_ = std::move(other.pipeline_names_);
+            compiler_ = std::move(other.compiler_);
         }
         return *this;
     }
 
     PipelineCache::~PipelineCache()
     {
-        for (const auto& [_, pipeline] : pipelines_) {
-            vkDestroyPipeline(vk_device_, pipeline, nullptr);
-            ORION_RENDERER_LOG_INFO("Destroyed VkPipeline {}", fmt::ptr(pipeline));
+        destroy();
+    }
+
+    void PipelineCache::destroy()
+    {
+        // Pipelines still queued are dropped, only the ones being compiled are waited for
+        compiler_.reset();
+        for (const auto& entry : pipelines_) {
+            if (VkPipeline pipeline = entry.pipeline.load(std::memory_order_acquire)) {
+                vkDestroyPipeline(vk_device_, pipeline, nullptr);
+                ORION_RENDERER_LOG_INFO("Destroyed VkPipeline {}", fmt::ptr(pipeline));
+            }
+        }
+        pipelines_.clear();
+        pipeline_ids_.clear();
+        pipeline_names_.clear();
+        libraries_.reset();
+        shader_modules_.reset();
+        if (vk_pipeline_cache_ != VK_NULL_HANDLE) {
+            vkDestroyPipelineCache(vk_device_, vk_pipeline_cache_, nullptr);
+            ORION_RENDERER_LOG_INFO("Destroyed VkPipelineCache {}", fmt::ptr(vk_pipeline_cache_));
         }
         if (pipeline_layout_ != VK_NULL_HANDLE) {
             vkDestroyPipelineLayout(vk_device_, pipeline_layout_, nullptr);
@@ -271,8 +944,9 @@ namespace orion
         }
     }
 
-    tl::expected<PipelineCache, VkResult> PipelineCache::initialize(VkDevice device)
+    tl::expected<PipelineCache, VkResult> PipelineCache::initialize(const PipelineCacheDesc& desc)
     {
+        VkDevice device = desc.device;
         // Create fixed pipeline layout
         const auto pipeline_layout_info = VkPipelineLayoutCreateInfo{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
@@ -290,26 +964,262 @@ namespace orion
         } else {
             ORION_RENDERER_LOG_INFO("Created VkPipelineLayout {}", fmt::ptr(pipeline_layout));
         }
-        return PipelineCache{device, pipeline_layout};
+
+        // Create driver pipeline cache, seeded with the data of a previous run
+        //  Retried empty in case the driver rejects data that passed our checks.
+        const auto file_header = to_file_header(desc.device_properties);
+        const auto initial_data = read_cache_file(desc.cache_file, file_header);
+        auto pipeline_cache_info = VkPipelineCacheCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = {},
+            .initialDataSize = initial_data.size(),
+            .pInitialData = initial_data.data(),
+        };
+        VkPipelineCache vk_pipeline_cache = VK_NULL_HANDLE;
+        VkResult err = vkCreatePipelineCache(device, &pipeline_cache_info, nullptr, &vk_pipeline_cache);
+        if (err && !initial_data.empty()) {
+            ORION_RENDERER_LOG_WARN("vkCreatePipelineCache() failed with data of {}: {}, starting empty", desc.cache_file.string(), string_VkResult(err));
+            pipeline_cache_info.initialDataSize = 0;
+            pipeline_cache_info.pInitialData = nullptr;
+            err = vkCreatePipelineCache(device, &pipeline_cache_info, nullptr, &vk_pipeline_cache);
+        }
+        if (err) {
+            ORION_RENDERER_LOG_ERROR("vkCreatePipelineCache() failed: {}", string_VkResult(err));
+            vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+            return tl::unexpected(err);
+        } else {
+            ORION_RENDERER_LOG_INFO("Created VkPipelineCache {} ({} bytes of initial data)", fmt::ptr(vk_pipeline_cache), pipeline_cache_info.initialDataSize);
+        }
+        auto pipeline_cache = PipelineCache{desc, pipeline_layout, vk_pipeline_cache, file_header};
+        pipeline_cache.saved_size_ = pipeline_cache_info.initialDataSize;
+        return pipeline_cache;
     }
 
-    tl::expected<VkPipeline, VkResult> PipelineCache::build(std::string name, PipelineBuilder& builder)
+    PipelineCache::FileHeader PipelineCache::to_file_header(const VkPhysicalDeviceProperties& device_properties)
     {
-        auto pipeline = builder.build(vk_device_);
-        if (pipeline) {
-            ORION_RENDERER_LOG_INFO("Created VkPipeline (graphics) {} ({})", fmt::ptr(*pipeline), name);
-            auto [it, inserted] = pipelines_.insert(std::make_pair(std::move(name), *pipeline));
-            ORION_ASSERT(inserted);
+        auto file_header = FileHeader{
+            .magic = cache_file_magic,
+            .version = cache_file_version,
+            .vendor_id = device_properties.vendorID,
+            .device_id = device_properties.deviceID,
+            .driver_version = device_properties.driverVersion,
+            .pipeline_cache_uuid = {},
+            .reserved = 0,
+            .data_size = 0,
+            .data_hash = 0,
+        };
+        std::ranges::copy(device_properties.pipelineCacheUUID, file_header.pipeline_cache_uuid.begin());
+        return file_header;
+    }
+
+    std::vector<std::byte> PipelineCache::read_cache_file(const std::filesystem::path& cache_file, const FileHeader& file_header)
+    {
+        auto file = std::ifstream{cache_file, std::ios::binary};
+        if (!file) {
+            ORION_RENDERER_LOG_INFO("No pipeline cache file {}", cache_file.string());
+            return {};
         }
-        return pipeline;
+
+        // Files of another device, driver or format version are stale rather than corrupted
+        auto header = FileHeader{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != file_header.magic) {
+            ORION_RENDERER_LOG_WARN("Ignoring pipeline cache file {}: not a pipeline cache", cache_file.string());
+            return {};
+        }
+        if (header.version != file_header.version || header.vendor_id != file_header.vendor_id || header.device_id != file_header.device_id ||
+            header.driver_version != file_header.driver_version || header.pipeline_cache_uuid != file_header.pipeline_cache_uuid) {
+            ORION_RENDERER_LOG_INFO("Ignoring pipeline cache file {}: written for another device or driver", cache_file.string());
+            return {};
+        }
+
+        // Truncated or damaged data must never reach the driver
+        std::error_code ec;
+        const auto file_size = std::filesystem::file_size(cache_file, ec);
+        if (ec || file_size != sizeof(header) + header.data_size) {
+            ORION_RENDERER_LOG_WARN("Ignoring pipeline cache file {}: size mismatch", cache_file.string());
+            return {};
+        }
+        auto data = std::vector<std::byte>(static_cast<std::size_t>(header.data_size));
+        if (!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())) || hash_bytes(data) != header.data_hash) {
+            ORION_RENDERER_LOG_WARN("Ignoring pipeline cache file {}: checksum mismatch", cache_file.string());
+            return {};
+        }
+
+        // The driver's own header has to agree with ours
+        auto data_header = VkPipelineCacheHeaderVersionOne{};
+        if (data.size() < sizeof(data_header)) {
+            ORION_RENDERER_LOG_WARN("Ignoring pipeline cache file {}: missing driver header", cache_file.string());
+            return {};
+        }
+        std::memcpy(&data_header, data.data(), sizeof(data_header));
+        if (data_header.headerSize < sizeof(data_header) || data_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+            data_header.vendorID != file_header.vendor_id || data_header.deviceID != file_header.device_id ||
+            !std::ranges::equal(data_header.pipelineCacheUUID, file_header.pipeline_cache_uuid)) {
+            ORION_RENDERER_LOG_WARN("Ignoring pipeline cache file {}: driver header mismatch", cache_file.string());
+            return {};
+        }
+        return data;
     }
 
-    VkPipeline PipelineCache::get(std::string_view name) const
+    bool PipelineCache::save()
     {
-        if (auto it = pipelines_.find(name); it != pipelines_.end()) {
-            return it->second;
+        // Drivers only ever add to their cache
+        std::size_t data_size = 0;
+        if (VkResult err = vkGetPipelineCacheData(vk_device_, vk_pipeline_cache_, &data_size, nullptr)) {
+            ORION_RENDERER_LOG_ERROR("vkGetPipelineCacheData() failed: {}", string_VkResult(err));
+            return false;
+        }
+        if (data_size == saved_size_) {
+            return true;
+        }
+        auto data = std::vector<std::byte>(data_size);
+        if (VkResult err = vkGetPipelineCacheData(vk_device_, vk_pipeline_cache_, &data_size, data.data())) {
+            // VK_INCOMPLETE when pipelines were added in the meantime, saved next time
+            if (err != VK_INCOMPLETE) {
+                ORION_RENDERER_LOG_ERROR("vkGetPipelineCacheData() failed: {}", string_VkResult(err));
+            }
+            return false;
+        }
+
+        auto header = file_header_;
+        header.data_size = data.size();
+        header.data_hash = hash_bytes(data);
+        auto temp_file = cache_file_;
+        temp_file += ".tmp";
+        {
+            auto file = std::ofstream{temp_file, std::ios::binary | std::ios::trunc};
+            if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+                !file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size())) ||
+                !file.flush()) {
+                ORION_RENDERER_LOG_ERROR("Failed to write pipeline cache file {}", temp_file.string());
+                return false;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(temp_file, cache_file_, ec);
+        if (ec) {
+            ORION_RENDERER_LOG_ERROR("Failed to replace pipeline cache file {}: {}", cache_file_.string(), ec.message());
+            std::filesystem::remove(temp_file, ec);
+            return false;
+        }
+        ORION_RENDERER_LOG_INFO("Wrote pipeline cache file {} ({} bytes)", cache_file_.string(), data.size());
+        saved_size_ = data.size();
+        return true;
+    }
+
+    tl::expected<PipelineId, VkResult> PipelineCache::build(std::string name, PipelineBuilder& builder)
+    {
+        // Identical state, possibly still compiling in the background
+        auto state_key = builder.state_key();
+        if (auto it = pipeline_ids_.find(state_key); it != pipeline_ids_.end()) {
+            const auto id = it->second;
+            if (auto result = pipelines_[id.index].future.get(); !result) {
+                return tl::unexpected(result.error());
+            }
+            add_name(std::move(name), id);
+            return id;
+        }
+
+        // Fast linked from libraries when available, the optimized link is left to the compile threads
+        auto libraries = PipelineLibraries{};
+        auto pipeline = tl::expected<VkPipeline, VkResult>{};
+        if (libraries_ != nullptr) {
+            pipeline = libraries_->get_libraries(builder).and_then([&](const PipelineLibraries& part_libraries) {
+                libraries = part_libraries;
+                return libraries_->link(libraries, false);
+            });
         } else {
-            return VK_NULL_HANDLE;
+            pipeline = builder.build(vk_device_, vk_pipeline_cache_);
+        }
+        if (!pipeline) {
+            return tl::unexpected(pipeline.error());
+        }
+        ORION_RENDERER_LOG_INFO("Created VkPipeline (graphics{}) {} ({})", libraries_ != nullptr ? ", fast linked" : "", fmt::ptr(*pipeline), name);
+        const auto id = PipelineId{static_cast<std::uint32_t>(pipelines_.size())};
+        auto& entry = pipelines_.emplace_back();
+        entry.pipeline.store(*pipeline, std::memory_order_release);
+        auto promise = std::promise<tl::expected<void, VkResult>>{};
+        promise.set_value({});
+        entry.future = promise.get_future().share();
+        pipeline_ids_.emplace(std::move(state_key), id);
+        add_name(name, id);
+        if (libraries_ != nullptr) {
+            compiler_->push({
+                .name = std::move(name),
+                .builder = nullptr,
+                .libraries = libraries,
+                .pipeline = &entry.pipeline,
+                .promise = {},
+            });
+        }
+        return id;
+    }
+
+    PipelineId PipelineCache::build_async(std::string name, std::unique_ptr<PipelineBuilder> builder, std::optional<PipelineId> fallback)
+    {
+        auto state_key = builder->state_key();
+        if (auto it = pipeline_ids_.find(state_key); it != pipeline_ids_.end()) {
+            add_name(std::move(name), it->second);
+            return it->second;
+        }
+
+        const auto id = PipelineId{static_cast<std::uint32_t>(pipelines_.size())};
+        auto& entry = pipelines_.emplace_back();
+        entry.fallback = fallback;
+        auto promise = std::promise<tl::expected<void, VkResult>>{};
+        entry.future = promise.get_future().share();
+        pipeline_ids_.emplace(std::move(state_key), id);
+        add_name(name, id);
+        compiler_->push({
+            .name = std::move(name),
+            .builder = std::move(builder),
+            .libraries = {},
+            .pipeline = &entry.pipeline,
+            .promise = std::move(promise),
+        });
+        return id;
+    }
+
+    void PipelineCache::add_name(std::string name, PipelineId id)
+    {
+        [[maybe_unused]] auto [_, inserted] = pipeline_names_.try_emplace(std::move(name), id);
+        ORION_ASSERT(inserted);
+    }
+
+    VkPipeline PipelineCache::get(PipelineId id) const
+    {
+        ORION_ASSERT(id.index < pipelines_.size());
+        const auto& entry = pipelines_[id.index];
+        if (VkPipeline pipeline = entry.pipeline.load(std::memory_order_acquire)) {
+            return pipeline;
+        }
+        return entry.fallback ? get(*entry.fallback) : VK_NULL_HANDLE;
+    }
+
+    std::optional<PipelineId> PipelineCache::find(std::string_view name) const
+    {
+        if (auto it = pipeline_names_.find(name); it != pipeline_names_.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    PipelineFuture PipelineCache::get_future(PipelineId id) const
+    {
+        ORION_ASSERT(id.index < pipelines_.size());
+        return pipelines_[id.index].future;
+    }
+
+    void PipelineCache::wait_idle()
+    {
+        compiler_->wait_idle();
+    }
+
+    void PipelineCache::destroy_retired(std::uint64_t frame_value, std::uint64_t completed_value)
+    {
+        if (libraries_ != nullptr) {
+            libraries_->destroy_retired(frame_value, completed_value);
         }
     }
 } // namespace orion
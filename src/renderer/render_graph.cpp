@@ -8,7 +8,19 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <ranges>
 #include <stdexcept>
+#include <stop_token>
+#include <thread>
 
 namespace orion
 {
@@ -33,6 +45,108 @@ namespace orion
         unreachable();
     }
 
+    static TextureAccess to_read_texture_access(TextureHandle handle, TextureReadUsage usage)
+    {
+        static constexpr auto shader_stages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                                              VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+                                              VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        switch (usage) {
+            case TextureReadUsage::Sampled:
+                return {
+                    .handle = handle,
+                    .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    .stage = shader_stages,
+                    .access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                };
+            case TextureReadUsage::StorageRead:
+                return {
+                    .handle = handle,
+                    .layout = VK_IMAGE_LAYOUT_GENERAL,
+                    .stage = shader_stages,
+                    .access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+                };
+            case TextureReadUsage::InputAttachment:
+                // Same layout as sampled reads so both can share a barrier
+                return {
+                    .handle = handle,
+                    .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    .stage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                    .access = VK_ACCESS_2_INPUT_ATTACHMENT_READ_BIT,
+                };
+            case TextureReadUsage::DepthReadOnly:
+                // Depth testing without writes, optionally sampled in the same pass
+                return {
+                    .handle = handle,
+                    .layout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+                    .stage = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT | shader_stages,
+                    .access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                };
+        }
+        unreachable();
+    }
+
+    static BufferAccess to_write_buffer_access(BufferHandle handle, BufferUsage usage)
+    {
+        switch (usage) {
+            case BufferUsage::StorageWrite:
+                return {
+                    .handle = handle,
+                    .stage = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    .access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                };
+            case BufferUsage::TransferDst:
+                return {
+                    .handle = handle,
+                    .stage = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+                    .access = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                };
+        }
+        unreachable();
+    }
+
+    static BufferAccess to_read_buffer_access(BufferHandle handle, BufferReadUsage usage)
+    {
+        switch (usage) {
+            case BufferReadUsage::Vertex:
+                return {
+                    .handle = handle,
+                    .stage = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT,
+                    .access = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT,
+                };
+            case BufferReadUsage::Index:
+                return {
+                    .handle = handle,
+                    .stage = VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT,
+                    .access = VK_ACCESS_2_INDEX_READ_BIT,
+                };
+            case BufferReadUsage::Indirect:
+                return {
+                    .handle = handle,
+                    .stage = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                    .access = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+                };
+            case BufferReadUsage::StorageRead:
+                return {
+                    .handle = handle,
+                    .stage = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    .access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+                };
+            case BufferReadUsage::Uniform:
+                return {
+                    .handle = handle,
+                    .stage = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    .access = VK_ACCESS_2_UNIFORM_READ_BIT,
+                };
+            case BufferReadUsage::TransferSrc:
+                return {
+                    .handle = handle,
+                    .stage = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+                    .access = VK_ACCESS_2_TRANSFER_READ_BIT,
+                };
+        }
+        unreachable();
+    }
+
     static bool is_write_access(VkAccessFlags2 access_flags)
     {
         static constexpr auto write_mask = VK_ACCESS_2_SHADER_WRITE_BIT |
@@ -45,11 +159,76 @@ namespace orion
         return (access_flags & write_mask) != 0;
     }
 
-    static bool requires_image_barrier(const TextureAccess& src, const TextureAccess& dst)
+    static VkPipelineStageFlags2 to_compute_queue_stages(VkPipelineStageFlags2 stage)
+    {
+        // Compute queues only support the compute and transfer parts of the pipeline
+        static constexpr auto compute_queue_stages = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT |
+                                                     VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
+                                                     VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT |
+                                                     VK_PIPELINE_STAGE_2_COPY_BIT;
+        return stage & compute_queue_stages;
+    }
+
+    static bool is_attachment_access(VkAccessFlags2 access_flags)
+    {
+        static constexpr auto attachment_mask = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT |
+                                                VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                                                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        return (access_flags & attachment_mask) != 0;
+    }
+
+    // Reads in the same layout need no ordering between each other,
+    // only against the preceding write or layout transition
+    static bool is_read_after_read(const TextureAccess& src, const TextureAccess& dst)
     {
-        const auto is_layout_change = src.layout != dst.layout;
+        const auto is_same_layout = src.layout == dst.layout;
         const auto is_write = is_write_access(src.access) || is_write_access(dst.access);
-        return is_layout_change || is_write;
+        return is_same_layout && !is_write;
+    }
+
+    static bool requires_image_barrier(const TextureAccess& src, const TextureAccess& dst)
+    {
+        return !is_read_after_read(src, dst);
+    }
+
+    static constexpr auto no_pass = std::numeric_limits<std::size_t>::max();
+
+    // Guaranteed by every desktop GPU, rendering scopes are recorded without allocating
+    static constexpr std::size_t max_color_attachments = 8;
+
+    // Stages and accesses that consume an imported texture after the graph, in its final layout
+    static std::pair<VkPipelineStageFlags2, VkAccessFlags2> to_final_stage_access(VkImageLayout layout)
+    {
+        switch (layout) {
+            case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+                // Presentation is ordered by the semaphore signalled at submit, no stage or access to make visible
+                return {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+            case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+                return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+            case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+                return {VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT};
+            case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+                return {VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT};
+            case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+                return {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT};
+            default:
+                // Unknown consumer outside the graph
+                return {VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT};
+        }
+    }
+
+    static VkDependencyInfo to_dependency_info(const std::vector<VkBufferMemoryBarrier2>& buffer_barriers,
+                                               const std::vector<VkImageMemoryBarrier2>& image_barriers)
+    {
+        return {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .pNext = nullptr,
+            .bufferMemoryBarrierCount = static_cast<std::uint32_t>(buffer_barriers.size()),
+            .pBufferMemoryBarriers = buffer_barriers.data(),
+            .imageMemoryBarrierCount = static_cast<std::uint32_t>(image_barriers.size()),
+            .pImageMemoryBarriers = image_barriers.data(),
+        };
     }
 
     static VkImageAspectFlags to_image_aspect_flags(VkFormat format)
@@ -63,6 +242,244 @@ namespace orion
         }
     }
 
+    static bool ranges_overlap(const VkImageSubresourceRange& lhs, const VkImageSubresourceRange& rhs)
+    {
+        return lhs.baseMipLevel < rhs.baseMipLevel + rhs.levelCount && rhs.baseMipLevel < lhs.baseMipLevel + lhs.levelCount &&
+               lhs.baseArrayLayer < rhs.baseArrayLayer + rhs.layerCount && rhs.baseArrayLayer < lhs.baseArrayLayer + lhs.layerCount;
+    }
+
+    static bool ranges_equal(const VkImageSubresourceRange& lhs, const VkImageSubresourceRange& rhs)
+    {
+        return lhs.baseMipLevel == rhs.baseMipLevel && lhs.levelCount == rhs.levelCount &&
+               lhs.baseArrayLayer == rhs.baseArrayLayer && lhs.layerCount == rhs.layerCount;
+    }
+
+    // Calls fn with the state index and range of every single subresource in range, mip level major
+    template<typename F>
+    static void for_each_subresource(const RenderGraph::TextureDesc& desc, const VkImageSubresourceRange& range, F&& fn)
+    {
+        for (auto mip_level = range.baseMipLevel; mip_level < range.baseMipLevel + range.levelCount; ++mip_level) {
+            for (auto array_layer = range.baseArrayLayer; array_layer < range.baseArrayLayer + range.layerCount; ++array_layer) {
+                const auto subresource_range = VkImageSubresourceRange{
+                    .aspectMask = range.aspectMask,
+                    .baseMipLevel = mip_level,
+                    .levelCount = 1,
+                    .baseArrayLayer = array_layer,
+                    .layerCount = 1,
+                };
+                fn(static_cast<std::size_t>(mip_level) * desc.array_layers + array_layer, subresource_range);
+            }
+        }
+    }
+
+    static bool try_merge_image_barrier(VkImageMemoryBarrier2& barrier, const VkImageMemoryBarrier2& next)
+    {
+        const auto same_synchronization = barrier.srcStageMask == next.srcStageMask && barrier.srcAccessMask == next.srcAccessMask &&
+                                          barrier.dstStageMask == next.dstStageMask && barrier.dstAccessMask == next.dstAccessMask &&
+                                          barrier.oldLayout == next.oldLayout && barrier.newLayout == next.newLayout &&
+                                          barrier.srcQueueFamilyIndex == next.srcQueueFamilyIndex &&
+                                          barrier.dstQueueFamilyIndex == next.dstQueueFamilyIndex;
+        if (!same_synchronization) {
+            return false;
+        }
+        auto& range = barrier.subresourceRange;
+        const auto& next_range = next.subresourceRange;
+        if (range.baseMipLevel == next_range.baseMipLevel && range.levelCount == next_range.levelCount &&
+            range.baseArrayLayer + range.layerCount == next_range.baseArrayLayer) {
+            range.layerCount += next_range.layerCount;
+            return true;
+        }
+        if (range.baseArrayLayer == next_range.baseArrayLayer && range.layerCount == next_range.layerCount &&
+            range.baseMipLevel + range.levelCount == next_range.baseMipLevel) {
+            range.levelCount += next_range.levelCount;
+            return true;
+        }
+        return false;
+    }
+
+    // Barriers are emitted per subresource, consecutive subresources of a texture sharing
+    // the same synchronization are merged back into one barrier
+    static void push_image_barrier(std::vector<VkImageMemoryBarrier2>& barriers, std::vector<std::uint16_t>& barrier_textures,
+                                   const VkImageMemoryBarrier2& barrier, std::uint16_t texture_idx)
+    {
+        const auto count = barriers.size();
+        if (count > 0 && barrier_textures.back() == texture_idx && try_merge_image_barrier(barriers.back(), barrier)) {
+            // A completed row of array layers can extend the previous mip levels
+            if (count > 1 && barrier_textures[count - 2] == texture_idx && try_merge_image_barrier(barriers[count - 2], barriers.back())) {
+                barriers.pop_back();
+                barrier_textures.pop_back();
+            }
+            return;
+        }
+        barriers.push_back(barrier);
+        barrier_textures.push_back(texture_idx);
+    }
+
+    static std::uint32_t to_size_bucket(std::uint32_t dimension)
+    {
+        // Eight buckets per power of two, rounding up wastes at most an eighth
+        if (dimension <= 64) {
+            return dimension;
+        }
+        const auto step = std::bit_floor(dimension) / 8;
+        return (dimension + step - 1) / step * step;
+    }
+
+    static VkImageCreateInfo to_image_create_info(const RenderGraph::TextureDesc& desc)
+    {
+        return {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = {},
+            .imageType = desc.image_type,
+            .format = desc.format,
+            .extent = desc.extent,
+            .mipLevels = desc.mip_levels,
+            .arrayLayers = desc.array_layers,
+            .samples = desc.samples,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = desc.usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+    }
+
+    // Escapes quotes and backslashes, enough for the identifiers passes are named with
+    static std::string escape_string(std::string_view str)
+    {
+        std::string escaped;
+        escaped.reserve(str.size());
+        for (char c : str) {
+            if (c == '"' || c == '\\') {
+                escaped.push_back('\\');
+            }
+            escaped.push_back(c);
+        }
+        return escaped;
+    }
+
+    static const char* to_string(PassQueue queue)
+    {
+        return queue == PassQueue::Graphics ? "Graphics" : "AsyncCompute";
+    }
+
+    static const char* to_string(RenderGraph::ResourceLifetime lifetime)
+    {
+        return lifetime == RenderGraph::ResourceLifetime::Transient ? "Transient" : "Persistent";
+    }
+
+    static std::string to_json_queue_family(std::uint32_t queue_family)
+    {
+        return queue_family == VK_QUEUE_FAMILY_IGNORED ? "null" : std::to_string(queue_family);
+    }
+
+    static void append_json_barriers(std::string& out,
+                                     std::span<const VkBufferMemoryBarrier2> buffer_barriers,
+                                     std::span<const std::uint16_t> buffer_barrier_buffers,
+                                     std::span<const VkImageMemoryBarrier2> image_barriers,
+                                     std::span<const std::uint16_t> image_barrier_textures)
+    {
+        auto it = std::back_inserter(out);
+        out += "\"image_barriers\":[";
+        for (std::size_t i = 0; i < image_barriers.size(); ++i) {
+            const auto& barrier = image_barriers[i];
+            const auto& range = barrier.subresourceRange;
+            fmt::format_to(it, R"({}{{"texture":{},"src_stage":"{}","src_access":"{}","dst_stage":"{}","dst_access":"{}",)"
+                               R"("old_layout":"{}","new_layout":"{}","base_mip_level":{},"mip_level_count":{},"base_array_layer":{},"array_layer_count":{},)"
+                               R"("src_queue_family":{},"dst_queue_family":{}}})",
+                           i == 0 ? "" : ",", image_barrier_textures[i],
+                           string_VkPipelineStageFlags2(barrier.srcStageMask), string_VkAccessFlags2(barrier.srcAccessMask),
+                           string_VkPipelineStageFlags2(barrier.dstStageMask), string_VkAccessFlags2(barrier.dstAccessMask),
+                           string_VkImageLayout(barrier.oldLayout), string_VkImageLayout(barrier.newLayout),
+                           range.baseMipLevel, range.levelCount, range.baseArrayLayer, range.layerCount,
+                           to_json_queue_family(barrier.srcQueueFamilyIndex), to_json_queue_family(barrier.dstQueueFamilyIndex));
+        }
+        out += "],\"buffer_barriers\":[";
+        for (std::size_t i = 0; i < buffer_barriers.size(); ++i) {
+            const auto& barrier = buffer_barriers[i];
+            fmt::format_to(it, R"({}{{"buffer":{},"src_stage":"{}","src_access":"{}","dst_stage":"{}","dst_access":"{}",)"
+                               R"("src_queue_family":{},"dst_queue_family":{}}})",
+                           i == 0 ? "" : ",", buffer_barrier_buffers[i],
+                           string_VkPipelineStageFlags2(barrier.srcStageMask), string_VkAccessFlags2(barrier.srcAccessMask),
+                           string_VkPipelineStageFlags2(barrier.dstStageMask), string_VkAccessFlags2(barrier.dstAccessMask),
+                           to_json_queue_family(barrier.srcQueueFamilyIndex), to_json_queue_family(barrier.dstQueueFamilyIndex));
+        }
+        out += "]";
+    }
+
+    // Worker threads recording pass groups, waiting for the next frame in between
+    //  Spawning threads every frame would allocate their state on the heap.
+    class RecordingThreadPool
+    {
+    public:
+        explicit RecordingThreadPool(std::size_t worker_count)
+        {
+            workers_.reserve(worker_count);
+            for (std::size_t worker_idx = 0; worker_idx < worker_count; ++worker_idx) {
+                workers_.emplace_back([this, worker_idx](std::stop_token stop_token) { work(stop_token, worker_idx + 1); });
+            }
+        }
+        RecordingThreadPool(const RecordingThreadPool&) = delete;
+        RecordingThreadPool& operator=(const RecordingThreadPool&) = delete;
+
+        std::size_t worker_count() const { return workers_.size(); }
+
+        // Runs group 0 on the calling thread and every other group on a worker, returns once all groups are done
+        //  record_group must not throw.
+        template<typename F>
+        void run(std::size_t group_count, const F& record_group)
+        {
+            ORION_ASSERT(group_count >= 1 && group_count <= workers_.size() + 1);
+            {
+                auto lock = std::scoped_lock{mutex_};
+                job_ = [](const void* context, std::size_t group) { (*static_cast<const F*>(context))(group); };
+                job_context_ = &record_group;
+                group_count_ = group_count;
+                pending_groups_ = group_count - 1;
+                ++generation_;
+            }
+            start_.notify_all();
+            record_group(0);
+
+            auto lock = std::unique_lock{mutex_};
+            done_.wait(lock, [this] { return pending_groups_ == 0; });
+        }
+
+    private:
+        void work(std::stop_token stop_token, std::size_t group)
+        {
+            auto generation = std::uint64_t{0};
+            auto lock = std::unique_lock{mutex_};
+            while (start_.wait(lock, stop_token, [&] { return generation_ != generation; })) {
+                generation = generation_;
+                if (group >= group_count_) {
+                    continue;
+                }
+                const auto job = job_;
+                const auto* job_context = job_context_;
+                lock.unlock();
+                job(job_context, group);
+                lock.lock();
+                if (--pending_groups_ == 0) {
+                    done_.notify_one();
+                }
+            }
+        }
+
+        std::mutex mutex_;
+        std::condition_variable_any start_;
+        std::condition_variable done_;
+        std::uint64_t generation_ = 0;
+        void (*job_)(const void*, std::size_t) = nullptr;
+        const void* job_context_ = nullptr;
+        std::size_t group_count_ = 0;
+        std::size_t pending_groups_ = 0;
+        // Last member, workers are joined before the state they wait on is destroyed
+        std::vector<std::jthread> workers_;
+    };
+
     RenderPassContext::RenderPassContext(RenderGraph& graph, VkCommandBuffer command_buffer)
         : graph_(graph)
         , command_buffer_(command_buffer)
@@ -71,7 +488,36 @@ namespace orion
 
     VkImageView RenderPassContext::get_image_view(TextureHandle handle) const
     {
-        return graph_.get_texture(handle).image_view;
+        return graph_.get_image_view(handle);
+    }
+
+    VkRect2D RenderPassContext::get_render_area(TextureHandle handle) const
+    {
+        const auto& extent = graph_.get_texture(handle).desc.extent;
+        const auto mip_level = graph_.get_subresource_range(handle).baseMipLevel;
+        return {.offset = {0, 0}, .extent = {std::max(extent.width >> mip_level, 1u), std::max(extent.height >> mip_level, 1u)}};
+    }
+
+    VkExtent3D RenderPassContext::get_image_extent(TextureHandle handle) const
+    {
+        const auto& extent = graph_.get_texture(handle).image_extent;
+        const auto mip_level = graph_.get_subresource_range(handle).baseMipLevel;
+        return {std::max(extent.width >> mip_level, 1u), std::max(extent.height >> mip_level, 1u), std::max(extent.depth >> mip_level, 1u)};
+    }
+
+    VkAttachmentLoadOp RenderPassContext::get_load_op(TextureHandle handle) const
+    {
+        return graph_.get_attachment_ops(position_, handle).load_op;
+    }
+
+    VkAttachmentStoreOp RenderPassContext::get_store_op(TextureHandle handle) const
+    {
+        return graph_.get_attachment_ops(position_, handle).store_op;
+    }
+
+    VkBuffer RenderPassContext::get_buffer(BufferHandle handle) const
+    {
+        return graph_.get_buffer(handle).buffer;
     }
 
     RenderPassBuilder::RenderPassBuilder(RenderPass& pass)
@@ -86,57 +532,276 @@ namespace orion
         return handle;
     }
 
-    void RenderGraph::reset()
+    void RenderPassBuilder::read_texture(TextureHandle handle, TextureReadUsage usage)
     {
-        // Free all transient resources that were not used in the last frame
-        for (auto it = transient_textures_.begin(); it != transient_textures_.end();) {
-            if (it->second.frames_since_use >= 1) {
-                vkDestroyImageView(vk_device_, it->second.view, nullptr);
-                ORION_RENDERER_LOG_INFO("Destroyed VkImageView {}", fmt::ptr(it->second.view));
-                vmaDestroyImage(vma_allocator_, it->second.image, it->second.allocation);
-                ORION_RENDERER_LOG_INFO("Destroyed VkImage {} with VmaAllocation {} (unused in previous frame)", fmt::ptr(it->second.image), fmt::ptr(it->second.allocation));
-                it = transient_textures_.erase(it);
-            } else {
-                ++it;
-            }
-        }
+        pass_.texture_accesses.push_back(to_read_texture_access(handle, usage));
+    }
 
-        final_layout_transitions_.clear();
-        sorted_passes_.clear();
+    BufferHandle RenderPassBuilder::write_buffer(BufferHandle handle, BufferUsage usage)
+    {
+        pass_.buffer_accesses.push_back(to_write_buffer_access(handle, usage));
+        ++handle.version;
+        return handle;
+    }
+
+    void RenderPassBuilder::read_buffer(BufferHandle handle, BufferReadUsage usage)
+    {
+        pass_.buffer_accesses.push_back(to_read_buffer_access(handle, usage));
+    }
+
+    void RenderPassBuilder::set_async_compute()
+    {
+        pass_.queue = PassQueue::AsyncCompute;
+    }
+
+    void RenderPassBuilder::set_rendering(VkRect2D render_area, std::uint32_t view_mask)
+    {
+        pass_.render_area = render_area;
+        pass_.view_mask = view_mask;
+    }
+
+    void RenderPassBuilder::set_clear_value(TextureHandle handle, VkClearValue value)
+    {
+        pass_.clear_values.push_back({handle, value});
+    }
+
+    TextureHandle RenderPassBuilder::resolve_texture(TextureHandle source, TextureHandle target, VkResolveModeFlagBits mode)
+    {
+        // Resolves are written in the color attachment output stage
+        pass_.resolves.push_back({source, target, mode});
+        return write_texture(target, TextureUsage::ColorAttachment);
+    }
+
+    void RenderGraph::reset(std::uint64_t frame_value)
+    {
+        // Allocations still held were not returned by submit(), the frame was recorded with execute() or dropped
+        //  Returned after eviction, which would otherwise count them as unused memory.
+        transient_heap_->evict();
+        release_transient_allocations(frame_value_);
+        frame_value_ = frame_value;
+        read_back_timestamps();
+
+        // Keep the compiled schedule and barriers, the next frame likely declares the same graph
+        //  Swapped rather than moved so both sides keep their capacity.
+        std::swap(compiled_textures_, textures_);
+        std::swap(compiled_buffers_, buffers_);
         passes_.clear();
         textures_.clear();
+        buffers_.clear();
+
+        // Nothing allocated from the arena is alive anymore
+        frame_arena_->reset();
+    }
+
+    void RenderGraph::set_timestamp_queries(const TimestampQueryDesc& desc)
+    {
+        timestamp_queries_ = desc;
+        timestamps_recorded_ = false;
+        pass_timings_.clear();
+    }
+
+    void RenderGraph::read_back_timestamps()
+    {
+        pass_timings_.clear();
+        if (!timestamps_recorded_) {
+            return;
+        }
+        timestamps_recorded_ = false;
+
+        // Passes and schedule still describe the previous submission, which the frame semaphore has passed
+        //  Results are read with availability instead of waiting in case the caller did not wait for it.
+        const auto query_pool = timestamp_queries_->query_pool;
+        const auto to_milliseconds = static_cast<double>(timestamp_queries_->timestamp_period) / 1e6;
+        for (const auto& segment : segments_) {
+            const auto last_position = timestamp_position_end(segment.first_position, segment.last_position);
+            if (last_position == segment.first_position) {
+                continue;
+            }
+            // Value and availability of each query
+            const auto query_count = 2 * (last_position - segment.first_position);
+            timestamp_results_.resize(2 * query_count);
+            const auto err = vkGetQueryPoolResults(vk_device_, query_pool,
+                                                   static_cast<std::uint32_t>(2 * segment.first_position),
+                                                   static_cast<std::uint32_t>(query_count),
+                                                   timestamp_results_.size() * sizeof(std::uint64_t),
+                                                   timestamp_results_.data(),
+                                                   2 * sizeof(std::uint64_t),
+                                                   VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+            if (err != VK_SUCCESS && err != VK_NOT_READY) {
+                throw std::runtime_error(fmt::format("vkGetQueryPoolResults() failed: {}", string_VkResult(err)));
+            }
+            for (auto position = segment.first_position; position < last_position; ++position) {
+                auto end_position = position;
+                if (auto scope = multiview_scope(position)) {
+                    if (rendering_scopes_[*scope].first_position != position) {
+                        continue;
+                    }
+                    end_position = rendering_scopes_[*scope].last_position - 1;
+                    if (end_position >= last_position) {
+                        continue;
+                    }
+                }
+                const auto* begin_result = &timestamp_results_[4 * (position - segment.first_position)];
+                const auto* end_result = &timestamp_results_[4 * (end_position - segment.first_position) + 2];
+                const auto begin = begin_result[0];
+                const auto end = end_result[0];
+                if (begin_result[1] == 0 || end_result[1] == 0 || end < begin) {
+                    continue;
+                }
+                pass_timings_.push_back({
+                    .name = passes_[sorted_passes_[position]].name,
+                    .queue = segment.queue,
+                    .milliseconds = static_cast<double>(end - begin) * to_milliseconds,
+                });
+            }
+        }
+    }
+
+    RenderPass& RenderGraph::emplace_pass(std::string_view name)
+    {
+        // Names are interned when first seen, later frames find them without allocating
+        auto it = pass_names_.find(name);
+        if (it == pass_names_.end()) {
+            it = pass_names_.emplace(name).first;
+        }
+        auto* frame_arena = frame_arena_.get();
+        return passes_.emplace_back(RenderPass{
+            .name = *it,
+            .clear_values = std::pmr::vector<AttachmentClearValue>{frame_arena},
+            .resolves = std::pmr::vector<AttachmentResolve>{frame_arena},
+            .texture_accesses = std::pmr::vector<TextureAccess>{frame_arena},
+            .buffer_accesses = std::pmr::vector<BufferAccess>{frame_arena},
+            .dependencies = std::pmr::vector<std::size_t>{frame_arena},
+        });
+    }
+
+    void RenderGraph::acquire_transient_allocations()
+    {
+        // Left over when the graph is compiled again before it is submitted
+        release_transient_allocations(frame_value_);
+
+        // The heap can hand out other blocks than last frame, textures are bound to the images placed in them again
+        //  Memory shared with an earlier frame still in flight is waited for before the graph runs.
+        transient_wait_value_ = 0;
+        for (const auto& block : transient_blocks_) {
+            transient_memory_blocks_.push_back(transient_heap_->acquire_memory_block(block.requirements, block.lazily_allocated, frame_value_));
+            transient_wait_value_ = std::max(transient_wait_value_, transient_memory_blocks_.back().release_value);
+        }
+        for (auto& texture : textures_) {
+            if (!texture.memory_block) {
+                continue;
+            }
+            const auto allocation_desc = to_allocation_desc(texture);
+            auto& memory_block = transient_memory_blocks_[*texture.memory_block];
+            const auto& image = transient_heap_->get_image(memory_block, allocation_desc);
+            texture.image = image.image;
+            texture.image_view = image.view;
+            texture.image_extent = allocation_desc.extent;
+            for (auto& subresource_view : texture.subresource_views) {
+                subresource_view.view = transient_heap_->get_image_view(memory_block, allocation_desc, subresource_view.range);
+            }
+        }
+        for (auto& buffer : buffers_) {
+            // If imported buffer or only used by culled passes, skip it
+            if (buffer.lifetime != ResourceLifetime::Transient || !buffer.referenced) {
+                continue;
+            }
+            transient_buffers_.push_back(transient_heap_->acquire_buffer(buffer.desc, frame_value_));
+            transient_wait_value_ = std::max(transient_wait_value_, transient_buffers_.back().release_value);
+            buffer.buffer = transient_buffers_.back().buffer;
+        }
+
+        // Without sharing in flight memory the heap only hands out memory the GPU is done with, nothing to wait for
+        if (!transient_heap_->desc().share_in_flight_memory) {
+            transient_wait_value_ = 0;
+        }
+    }
+
+    void RenderGraph::release_transient_allocations(std::uint64_t frame_value)
+    {
+        for (auto& memory_block : transient_memory_blocks_) {
+            transient_heap_->release_memory_block(std::move(memory_block), frame_value);
+        }
+        transient_memory_blocks_.clear();
+        for (auto& buffer : transient_buffers_) {
+            transient_heap_->release_buffer(buffer, frame_value);
+        }
+        transient_buffers_.clear();
+    }
+
+    RenderGraph::TextureDesc RenderGraph::to_allocation_desc(const TextureDesc& desc) const
+    {
+        if (!transient_heap_->desc().bucket_extents) {
+            return desc;
+        }
+        auto allocation_desc = desc;
+        allocation_desc.extent.width = to_size_bucket(desc.extent.width);
+        allocation_desc.extent.height = to_size_bucket(desc.extent.height);
+        return allocation_desc;
+    }
+
+    RenderGraph::TextureDesc RenderGraph::to_allocation_desc(const Texture& texture) const
+    {
+        auto allocation_desc = to_allocation_desc(texture.desc);
+        if (texture.lazily_allocated) {
+            allocation_desc.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+        return allocation_desc;
     }
 
-    RenderGraph::RenderGraph(VkDevice device, VmaAllocator allocator)
+    RenderGraph::RenderGraph() = default;
+
+    RenderGraph::RenderGraph(VkDevice device, VmaAllocator allocator, std::shared_ptr<TransientHeap> transient_heap, std::uint32_t queue_family, std::uint32_t async_compute_queue_family)
         : vk_device_(device)
         , vma_allocator_(allocator)
+        , queue_family_(queue_family)
+        , async_compute_queue_family_(async_compute_queue_family)
+        , frame_arena_(std::make_unique<FrameArena>())
+        , transient_heap_(std::move(transient_heap))
     {
     }
 
+    RenderGraph::RenderGraph(RenderGraph&&) noexcept = default;
+    RenderGraph& RenderGraph::operator=(RenderGraph&&) noexcept = default;
+
     RenderGraph::~RenderGraph()
     {
-        for (const auto& [_, texture] : transient_textures_) {
-            vkDestroyImageView(vk_device_, texture.view, nullptr);
-            ORION_RENDERER_LOG_INFO("Destroyed VkImageView {}", fmt::ptr(texture.view));
-            vmaDestroyImage(vma_allocator_, texture.image, texture.allocation);
-            ORION_RENDERER_LOG_INFO("Destroyed VkImage {} with VmaAllocation {}", fmt::ptr(texture.image), fmt::ptr(texture.allocation));
+        // The current frame may still be using the allocations
+        release_transient_allocations(frame_value_);
+        for (VkEvent event : events_) {
+            vkDestroyEvent(vk_device_, event, nullptr);
+            ORION_RENDERER_LOG_INFO("Destroyed VkEvent {}", fmt::ptr(event));
+        }
+        for (const auto& recording_pool : recording_pools_) {
+            vkDestroyCommandPool(vk_device_, recording_pool.command_pool, nullptr);
+            ORION_RENDERER_LOG_INFO("Destroyed VkCommandPool {}", fmt::ptr(recording_pool.command_pool));
+        }
+        for (const auto& segment_pool : segment_pools_) {
+            if (segment_pool.command_pool != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(vk_device_, segment_pool.command_pool, nullptr);
+                ORION_RENDERER_LOG_INFO("Destroyed VkCommandPool {}", fmt::ptr(segment_pool.command_pool));
+            }
         }
     }
 
     TextureHandle RenderGraph::import_texture(const TextureImportDesc& desc)
     {
+        ORION_ASSERT(desc.extent.width > 0 && desc.extent.height > 0 && desc.extent.depth > 0);
         const auto index = static_cast<std::uint16_t>(textures_.size());
         textures_.push_back(Texture{
-            .lifetime = TextureLifetime::Persistent,
+            .lifetime = ResourceLifetime::Persistent,
             .image = desc.image,
             .image_view = desc.view,
             .current_layout = desc.current_layout,
-            .last_stage = VK_PIPELINE_STAGE_2_NONE,
-            .last_access = VK_ACCESS_2_NONE,
             .final_layout = desc.final_layout,
             .desc = {
                 .format = desc.format,
+                .extent = desc.extent,
+                .mip_levels = desc.mip_levels,
+                .array_layers = desc.array_layers,
+                .samples = desc.samples,
             },
+            .image_extent = desc.extent,
         });
         return {index, 0};
     }
@@ -145,212 +810,2235 @@ namespace orion
     {
         const auto index = static_cast<std::uint16_t>(textures_.size());
         textures_.push_back(Texture{
-            .lifetime = TextureLifetime::Transient,
+            .lifetime = ResourceLifetime::Transient,
             .desc = desc,
         });
         return {index, 0};
     }
 
+    TextureHandle RenderGraph::get_history_texture(std::string_view name, const TextureDesc& desc, std::uint32_t history_length, std::uint32_t frames_ago)
+    {
+        ORION_ASSERT(frames_ago < history_length);
+        auto& ring = transient_heap_->get_history_ring(name, desc, history_length, frame_value_);
+        const auto image_idx = (ring.current_image + ring.images.size() - frames_ago) % ring.images.size();
+        auto* history_image = &ring.images[image_idx];
+
+        // The same image has to be the same texture, barriers are tracked per texture
+        auto it = std::ranges::find(textures_, history_image, &Texture::history_image);
+        if (it != textures_.end()) {
+            return {static_cast<std::uint16_t>(it - textures_.begin()), 0};
+        }
+        const auto index = static_cast<std::uint16_t>(textures_.size());
+        textures_.push_back(Texture{
+            .lifetime = ResourceLifetime::Persistent,
+            .image = history_image->texture.image,
+            .image_view = history_image->texture.view,
+            .desc = ring.desc,
+            .image_extent = ring.desc.extent,
+            .history_image = history_image,
+        });
+        return {index, 0};
+    }
+
+    bool RenderGraph::is_history_valid(TextureHandle handle) const
+    {
+        const auto& texture = get_texture(handle);
+        ORION_ASSERT(texture.history_image != nullptr);
+        return texture.history_image->written_value != 0;
+    }
+
     const RenderGraph::Texture& RenderGraph::get_texture(TextureHandle handle) const
     {
         ORION_ASSERT(handle.index < textures_.size());
         return textures_[handle.index];
     }
 
-    void RenderGraph::compile()
+    VkImageView RenderGraph::get_image_view(TextureHandle handle) const
     {
-        compile_sort_passes();
-        compile_increment_transient_resource_last_use();
-        compile_allocate_transient_resources();
-        compile_emit_pass_barriers();
-        compile_emit_final_layout_transitions();
+        const auto& texture = get_texture(handle);
+        const auto range = get_subresource_range(handle);
+        if (range.levelCount == texture.desc.mip_levels && range.layerCount == texture.desc.array_layers) {
+            return texture.image_view;
+        }
+        // History images change every frame while the compiled graph stays, their views are kept with the image
+        const auto& subresource_views = texture.history_image ? texture.history_image->texture.subresource_views : texture.subresource_views;
+        auto it = std::ranges::find_if(subresource_views, [&](const SubresourceView& view) { return ranges_equal(view.range, range); });
+        ORION_ASSERT(it != subresource_views.end());
+        return it->view;
     }
 
-    void RenderGraph::execute(VkCommandBuffer command_buffer)
+    VkImageSubresourceRange RenderGraph::get_subresource_range(TextureHandle handle) const
     {
-        auto context = RenderPassContext{*this, command_buffer};
-        for (auto pass_idx : sorted_passes_) {
-            auto& pass = passes_[pass_idx];
-            if (!pass.image_barriers.empty()) {
-                const auto dependency_info = VkDependencyInfo{
-                    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-                    .pNext = nullptr,
-                    .imageMemoryBarrierCount = static_cast<std::uint32_t>(pass.image_barriers.size()),
-                    .pImageMemoryBarriers = pass.image_barriers.data(),
-                };
-                vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        const auto& desc = get_texture(handle).desc;
+        ORION_ASSERT(handle.base_mip_level < desc.mip_levels && handle.base_array_layer < desc.array_layers);
+        return {
+            .aspectMask = to_image_aspect_flags(desc.format),
+            .baseMipLevel = handle.base_mip_level,
+            .levelCount = handle.mip_level_count == TextureHandle::all_subresources ? desc.mip_levels - handle.base_mip_level : handle.mip_level_count,
+            .baseArrayLayer = handle.base_array_layer,
+            .layerCount = handle.array_layer_count == TextureHandle::all_subresources ? desc.array_layers - handle.base_array_layer : handle.array_layer_count,
+        };
+    }
+
+    const RenderGraph::AttachmentOps& RenderGraph::get_attachment_ops(std::size_t position, TextureHandle handle) const
+    {
+        const auto& attachment_ops = attachment_ops_[position];
+        auto it = std::ranges::find(attachment_ops, handle.index, &AttachmentOps::texture);
+        ORION_ASSERT(it != attachment_ops.end());
+        return *it;
+    }
+
+    BufferHandle RenderGraph::import_buffer(const BufferImportDesc& desc)
+    {
+        const auto index = static_cast<std::uint16_t>(buffers_.size());
+        buffers_.push_back(Buffer{
+            .lifetime = ResourceLifetime::Persistent,
+            .buffer = desc.buffer,
+            .desc = {
+                .size = desc.size,
+            },
+        });
+        return {index, 0};
+    }
+
+    BufferHandle RenderGraph::create_transient_buffer(const BufferDesc& desc)
+    {
+        const auto index = static_cast<std::uint16_t>(buffers_.size());
+        buffers_.push_back(Buffer{
+            .lifetime = ResourceLifetime::Transient,
+            .desc = desc,
+        });
+        return {index, 0};
+    }
+
+    const RenderGraph::Buffer& RenderGraph::get_buffer(BufferHandle handle) const
+    {
+        ORION_ASSERT(handle.index < buffers_.size());
+        return buffers_[handle.index];
+    }
+
+    void RenderGraph::compile()
+    {
+        // Same structure as the last compiled graph, only resource handles can differ
+        //  Keys are compared whole, a hash collision would silently record the wrong barriers.
+        compute_structure_key(structure_key_);
+        if (compiled_structure_key_ == structure_key_) {
+            reuse_compiled_graph();
+            update_history_images();
+            return;
+        }
+        std::swap(compiled_structure_key_, structure_key_);
+
+        sorted_passes_.clear();
+        segments_.clear();
+        position_segments_.clear();
+        barrier_batches_.clear();
+        split_barriers_.clear();
+        rendering_scopes_.clear();
+
+        compile_build_dependencies();
+        compile_cull_passes();
+        compile_sort_passes();
+        compile_partition_queue_segments();
+        compile_compute_transient_lifetimes();
+        compile_infer_attachment_ops();
+        compile_allocate_transient_resources();
+        acquire_transient_allocations();
+        compile_emit_pass_barriers();
+        compile_emit_buffer_barriers();
+        compile_emit_final_layout_transitions();
+        compile_link_split_barriers();
+        compile_build_rendering_scopes();
+        update_history_images();
+    }
+
+    void RenderGraph::execute(VkCommandBuffer command_buffer, std::uint32_t recording_threads)
+    {
+        // A single command buffer can only run on one queue, async compute needs submit()
+        ORION_ASSERT(segments_.size() == 1);
+        record_segment(command_buffer, 0, recording_threads);
+        timestamps_recorded_ = timestamp_queries_.has_value();
+    }
+
+    void RenderGraph::submit(const SubmitDesc& desc)
+    {
+        // The graph belongs to a single frame in flight, its previous submission has completed
+        for (auto& segment_pool : segment_pools_) {
+            if (segment_pool.command_pool == VK_NULL_HANDLE) {
+                continue;
             }
-            pass.execute(context);
+            if (VkResult err = vkResetCommandPool(vk_device_, segment_pool.command_pool, {})) {
+                throw std::runtime_error(fmt::format("vkResetCommandPool() failed: {}", string_VkResult(err)));
+            }
+            segment_pool.used_command_buffers = 0;
         }
 
-        // Final layout transitions for imported textures
-        if (!final_layout_transitions_.empty()) {
-            const auto dependency_info = VkDependencyInfo{
-                .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        const auto first_graphics_segment = std::ranges::find(segments_, PassQueue::Graphics, &QueueSegment::queue) - segments_.begin();
+        const auto first_async_compute_segment = std::ranges::find(segments_, PassQueue::AsyncCompute, &QueueSegment::queue) - segments_.begin();
+        const auto base_value = timeline_value_;
+        for (std::size_t segment = 0; segment < segments_.size(); ++segment) {
+            const auto& queue_segment = segments_[segment];
+            auto command_buffer = begin_segment_command_buffer(queue_segment.queue);
+            record_segment(command_buffer, segment, desc.recording_threads);
+            if (VkResult err = vkEndCommandBuffer(command_buffer)) {
+                throw std::runtime_error(fmt::format("vkEndCommandBuffer() failed: {}", string_VkResult(err)));
+            }
+
+            // Segment k signals base + k + 1 when complete
+            auto wait_semaphores = std::pmr::vector<VkSemaphoreSubmitInfo>{frame_arena_.get()};
+            if (queue_segment.wait_segment) {
+                wait_semaphores.push_back({
+                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                    .pNext = nullptr,
+                    .semaphore = desc.timeline_semaphore,
+                    .value = base_value + *queue_segment.wait_segment + 1,
+                    .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                    .deviceIndex = 0,
+                });
+            }
+            if (static_cast<std::ptrdiff_t>(segment) == first_graphics_segment) {
+                wait_semaphores.insert(wait_semaphores.end(), desc.wait_semaphores.begin(), desc.wait_semaphores.end());
+            }
+            // Transient memory released by a frame still in flight, both queues wait before their first access
+            const auto is_first_on_queue = static_cast<std::ptrdiff_t>(segment) == first_graphics_segment ||
+                                           static_cast<std::ptrdiff_t>(segment) == first_async_compute_segment;
+            if (is_first_on_queue && transient_wait_value_ != 0) {
+                wait_semaphores.push_back({
+                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                    .pNext = nullptr,
+                    .semaphore = transient_heap_->frame_semaphore(),
+                    .value = transient_wait_value_,
+                    .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                    .deviceIndex = 0,
+                });
+            }
+            auto signal_semaphores = std::pmr::vector<VkSemaphoreSubmitInfo>{frame_arena_.get()};
+            signal_semaphores.push_back({
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                .pNext = nullptr,
+                .semaphore = desc.timeline_semaphore,
+                .value = base_value + segment + 1,
+                .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                .deviceIndex = 0,
+            });
+            if (segment + 1 == segments_.size()) {
+                signal_semaphores.insert(signal_semaphores.end(), desc.signal_semaphores.begin(), desc.signal_semaphores.end());
+            }
+
+            const auto cb_submit_info = VkCommandBufferSubmitInfo{
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
                 .pNext = nullptr,
-                .imageMemoryBarrierCount = static_cast<std::uint32_t>(final_layout_transitions_.size()),
-                .pImageMemoryBarriers = final_layout_transitions_.data(),
+                .commandBuffer = command_buffer,
+                .deviceMask = 0,
             };
-            vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+            const auto submit_info = VkSubmitInfo2{
+                .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                .pNext = nullptr,
+                .flags = {},
+                .waitSemaphoreInfoCount = static_cast<std::uint32_t>(wait_semaphores.size()),
+                .pWaitSemaphoreInfos = wait_semaphores.data(),
+                .commandBufferInfoCount = 1,
+                .pCommandBufferInfos = &cb_submit_info,
+                .signalSemaphoreInfoCount = static_cast<std::uint32_t>(signal_semaphores.size()),
+                .pSignalSemaphoreInfos = signal_semaphores.data(),
+            };
+            VkQueue queue = queue_segment.queue == PassQueue::Graphics ? desc.queue : desc.async_compute_queue;
+            if (VkResult err = vkQueueSubmit2(queue, 1, &submit_info, VK_NULL_HANDLE)) {
+                throw std::runtime_error(fmt::format("vkQueueSubmit2() failed: {}", string_VkResult(err)));
+            }
+        }
+        timeline_value_ = base_value + segments_.size();
+        timestamps_recorded_ = timestamp_queries_.has_value();
+
+        // The next frame can take the memory right away, it waits for this one on the frame semaphore
+        release_transient_allocations(frame_value_);
+    }
+
+    void RenderGraph::compute_structure_key(std::vector<std::uint64_t>& key) const
+    {
+        // Everything compilation reads except imported resource handles
+        key.clear();
+        const auto add = [&key](std::uint64_t value) { key.push_back(value); };
+        add(textures_.size());
+        for (const auto& texture : textures_) {
+            // Resizing within a size bucket keeps the allocations and barriers
+            const auto allocation_desc = to_allocation_desc(texture.desc);
+            add(static_cast<std::uint64_t>(texture.lifetime));
+            add(texture.current_layout);
+            add(texture.final_layout);
+            add(allocation_desc.image_type);
+            add(allocation_desc.format);
+            // Imported images are not allocated by the graph, their size does not change compilation
+            if (texture.lifetime == ResourceLifetime::Transient) {
+                add(allocation_desc.extent.width);
+                add(allocation_desc.extent.height);
+                add(allocation_desc.extent.depth);
+            }
+            add(allocation_desc.usage);
+            add(allocation_desc.mip_levels);
+            add(allocation_desc.array_layers);
+            add(allocation_desc.samples);
+            // History images start in the state the previous frame left them in
+            add(texture.history_image != nullptr);
+            if (texture.history_image) {
+                for (const auto& state : texture.history_image->subresource_states) {
+                    add(state.layout);
+                    add(state.last_stage);
+                    add(state.last_access);
+                }
+            }
+        }
+        add(buffers_.size());
+        for (const auto& buffer : buffers_) {
+            add(static_cast<std::uint64_t>(buffer.lifetime));
+            add(buffer.desc.size);
+            add(buffer.desc.usage);
+        }
+        add(passes_.size());
+        for (const auto& pass : passes_) {
+            add(pass.texture_accesses.size());
+            for (const auto& access : pass.texture_accesses) {
+                add(access.handle.index);
+                add(access.handle.version);
+                add(access.handle.base_mip_level);
+                add(access.handle.mip_level_count);
+                add(access.handle.base_array_layer);
+                add(access.handle.array_layer_count);
+                add(access.layout);
+                add(access.stage);
+                add(access.access);
+            }
+            add(static_cast<std::uint64_t>(pass.queue));
+            // Render areas are read when recording, compilation only merges passes rendering to equal areas
+            //  The first pass with an equal area stands in for the area, resizing keeps the compiled graph.
+            add(pass.render_area.has_value());
+            if (pass.render_area) {
+                const auto equal_area = std::ranges::find_if(passes_, [&](const RenderPass& other) {
+                    return other.render_area && other.render_area->offset.x == pass.render_area->offset.x &&
+                           other.render_area->offset.y == pass.render_area->offset.y &&
+                           other.render_area->extent.width == pass.render_area->extent.width &&
+                           other.render_area->extent.height == pass.render_area->extent.height;
+                });
+                add(static_cast<std::uint64_t>(equal_area - passes_.begin()));
+                add(pass.view_mask);
+            }
+            add(pass.resolves.size());
+            for (const auto& resolve : pass.resolves) {
+                add(resolve.source.index);
+                add(resolve.target.index);
+                add(resolve.mode);
+            }
+            add(pass.buffer_accesses.size());
+            for (const auto& access : pass.buffer_accesses) {
+                add(access.handle.index);
+                add(access.handle.version);
+                add(access.stage);
+                add(access.access);
+            }
+        }
+    }
+
+    void RenderGraph::reuse_compiled_graph()
+    {
+        ORION_ASSERT(compiled_textures_.size() == textures_.size());
+        ORION_ASSERT(compiled_buffers_.size() == buffers_.size());
+
+        // Take the compiled state and transient bindings, keep the newly imported handles
+        for (std::size_t texture_idx = 0; texture_idx < textures_.size(); ++texture_idx) {
+            // Moved, the compiled state's vectors change hands without allocating
+            const auto declared = textures_[texture_idx];
+            textures_[texture_idx] = std::move(compiled_textures_[texture_idx]);
+            // The requested extent can differ within the same size bucket
+            textures_[texture_idx].desc = declared.desc;
+            if (declared.lifetime == ResourceLifetime::Persistent) {
+                textures_[texture_idx].image = declared.image;
+                textures_[texture_idx].image_view = declared.image_view;
+                textures_[texture_idx].image_extent = declared.image_extent;
+                textures_[texture_idx].history_image = declared.history_image;
+            }
+        }
+        for (std::size_t buffer_idx = 0; buffer_idx < buffers_.size(); ++buffer_idx) {
+            const auto imported = buffers_[buffer_idx];
+            buffers_[buffer_idx] = std::move(compiled_buffers_[buffer_idx]);
+            if (imported.lifetime == ResourceLifetime::Persistent) {
+                buffers_[buffer_idx].buffer = imported.buffer;
+            }
+        }
+
+        acquire_transient_allocations();
+
+        // Patch barriers in place, the wait dependencies point into these vectors
+        const auto patch_barriers = [this](auto& barriers) {
+            for (std::size_t i = 0; i < barriers.buffer_barriers.size(); ++i) {
+                barriers.buffer_barriers[i].buffer = buffers_[barriers.buffer_barrier_buffers[i]].buffer;
+            }
+            for (std::size_t i = 0; i < barriers.image_barriers.size(); ++i) {
+                barriers.image_barriers[i].image = textures_[barriers.image_barrier_textures[i]].image;
+            }
+        };
+        for (auto& batch : barrier_batches_) {
+            patch_barriers(batch);
+        }
+        for (auto& split_barrier : split_barriers_) {
+            patch_barriers(split_barrier);
+        }
+        for (auto& segment : segments_) {
+            patch_barriers(segment.release_batch);
+        }
+    }
+
+    void RenderGraph::compile_build_dependencies()
+    {
+        // Walk the passes in declaration order following each resource's version chain
+        //  Accessing version v depends on the pass that wrote version v,
+        //  writing version v additionally depends on every pass that read version v (WAR)
+        //  Texture subresources are tracked separately, passes using disjoint mip levels or array layers stay independent
+        struct ResourceUsers {
+            std::size_t writer = no_pass;
+            std::vector<std::size_t> readers;
+        };
+        auto texture_versions = std::vector<std::uint16_t>(textures_.size());
+        auto buffer_versions = std::vector<std::uint16_t>(buffers_.size());
+        auto subresource_users = std::vector<std::vector<ResourceUsers>>(textures_.size());
+        auto buffer_users = std::vector<ResourceUsers>(buffers_.size());
+        for (std::size_t texture_idx = 0; texture_idx < textures_.size(); ++texture_idx) {
+            const auto& desc = textures_[texture_idx].desc;
+            subresource_users[texture_idx].resize(static_cast<std::size_t>(desc.mip_levels) * desc.array_layers);
+        }
+
+        const auto track_version = [](std::uint16_t& version, [[maybe_unused]] std::uint16_t handle_version, VkAccessFlags2 access) {
+            // Accessing an outdated version means the handle returned from a previous write was dropped
+            ORION_ASSERT(handle_version == version);
+            if (is_write_access(access)) {
+                ++version;
+            }
+        };
+        const auto track_access = [](RenderPass& pass, std::size_t pass_idx, ResourceUsers& users, VkAccessFlags2 access) {
+            if (users.writer != no_pass && users.writer != pass_idx) {
+                pass.dependencies.push_back(users.writer);
+            }
+            if (is_write_access(access)) {
+                for (auto reader : users.readers) {
+                    if (reader != pass_idx) {
+                        pass.dependencies.push_back(reader);
+                    }
+                }
+                users.readers.clear();
+                users.writer = pass_idx;
+            } else {
+                users.readers.push_back(pass_idx);
+            }
+        };
+
+        for (std::size_t pass_idx = 0; pass_idx < passes_.size(); ++pass_idx) {
+            auto& pass = passes_[pass_idx];
+            for (const auto& access : pass.texture_accesses) {
+                const auto texture_idx = access.handle.index;
+                for_each_subresource(textures_[texture_idx].desc, get_subresource_range(access.handle), [&](std::size_t subresource, const VkImageSubresourceRange&) {
+                    track_access(pass, pass_idx, subresource_users[texture_idx][subresource], access.access);
+                });
+                track_version(texture_versions[texture_idx], access.handle.version, access.access);
+            }
+            for (const auto& access : pass.buffer_accesses) {
+                track_access(pass, pass_idx, buffer_users[access.handle.index], access.access);
+                track_version(buffer_versions[access.handle.index], access.handle.version, access.access);
+            }
+
+            // Remove duplicate edges from passes accessing multiple resources of the same producer
+            std::ranges::sort(pass.dependencies);
+            const auto [first, last] = std::ranges::unique(pass.dependencies);
+            pass.dependencies.erase(first, last);
+        }
+    }
+
+    void RenderGraph::compile_cull_passes()
+    {
+        // Passes writing persistent (imported) resources produce the graph's outputs,
+        // everything those passes do not transitively depend on is never consumed
+        std::vector<std::size_t> live_passes;
+        for (std::size_t pass_idx = 0; pass_idx < passes_.size(); ++pass_idx) {
+            auto& pass = passes_[pass_idx];
+            const auto writes_output_texture = std::ranges::any_of(pass.texture_accesses, [this](const TextureAccess& access) {
+                return is_write_access(access.access) && textures_[access.handle.index].lifetime == ResourceLifetime::Persistent;
+            });
+            const auto writes_output_buffer = std::ranges::any_of(pass.buffer_accesses, [this](const BufferAccess& access) {
+                return is_write_access(access.access) && buffers_[access.handle.index].lifetime == ResourceLifetime::Persistent;
+            });
+            const auto writes_output = writes_output_texture || writes_output_buffer;
+            pass.culled = !writes_output;
+            if (writes_output) {
+                live_passes.push_back(pass_idx);
+            }
+        }
+
+        // Walk back from the outputs through the dependency graph
+        while (!live_passes.empty()) {
+            const auto& pass = passes_[live_passes.back()];
+            live_passes.pop_back();
+            for (auto dependency : pass.dependencies) {
+                if (passes_[dependency].culled) {
+                    passes_[dependency].culled = false;
+                    live_passes.push_back(dependency);
+                }
+            }
+        }
+
+        // Only resources used by the remaining passes need memory and barriers
+        for (const auto& pass : passes_) {
+            if (!pass.culled) {
+                for (const auto& access : pass.texture_accesses) {
+                    textures_[access.handle.index].referenced = true;
+                }
+                for (const auto& access : pass.buffer_accesses) {
+                    buffers_[access.handle.index].referenced = true;
+                }
+            }
         }
     }
 
     void RenderGraph::compile_sort_passes()
     {
-        sorted_passes_.resize(passes_.size());
-        for (std::size_t i = 0; i < passes_.size(); ++i) {
-            sorted_passes_[i] = i;
+        // Topological sort (Kahn) over the dependency graph
+        //  Among the passes whose dependencies are all scheduled, pick the one whose
+        //  most recently scheduled dependency is furthest back. This spaces out producers and
+        //  consumers so barriers do not land back-to-back and independent work can overlap.
+        //  Ties keep declaration order.
+        auto remaining_dependencies = std::vector<std::size_t>(passes_.size());
+        auto dependents = std::vector<std::vector<std::size_t>>(passes_.size());
+        auto ready_passes = std::vector<std::size_t>{};
+        auto live_pass_count = std::size_t{0};
+        for (std::size_t pass_idx = 0; pass_idx < passes_.size(); ++pass_idx) {
+            // Culled passes are left out of the schedule entirely, along with their barriers
+            if (passes_[pass_idx].culled) {
+                continue;
+            }
+            ++live_pass_count;
+            remaining_dependencies[pass_idx] = passes_[pass_idx].dependencies.size();
+            for (auto dependency : passes_[pass_idx].dependencies) {
+                dependents[dependency].push_back(pass_idx);
+            }
+            if (remaining_dependencies[pass_idx] == 0) {
+                ready_passes.push_back(pass_idx);
+            }
+        }
+
+        auto positions = std::vector<std::size_t>(passes_.size());
+        const auto dependency_distance = [&](std::size_t pass_idx) {
+            auto distance = sorted_passes_.size() + 1;
+            for (auto dependency : passes_[pass_idx].dependencies) {
+                distance = std::min(distance, sorted_passes_.size() - positions[dependency]);
+            }
+            return distance;
+        };
+
+        sorted_passes_.reserve(live_pass_count);
+        while (!ready_passes.empty()) {
+            auto best = ready_passes.begin();
+            auto best_distance = dependency_distance(*best);
+            for (auto it = std::next(best); it != ready_passes.end(); ++it) {
+                const auto distance = dependency_distance(*it);
+                if (distance > best_distance || (distance == best_distance && *it < *best)) {
+                    best = it;
+                    best_distance = distance;
+                }
+            }
+
+            const auto pass_idx = *best;
+            ready_passes.erase(best);
+            positions[pass_idx] = sorted_passes_.size();
+            sorted_passes_.push_back(pass_idx);
+
+            for (auto dependent : dependents[pass_idx]) {
+                if (--remaining_dependencies[dependent] == 0) {
+                    ready_passes.push_back(dependent);
+                }
+            }
+        }
+
+        // Version chains only ever point backwards in declaration order, so the graph is acyclic
+        ORION_ASSERT(sorted_passes_.size() == live_pass_count);
+    }
+
+    void RenderGraph::compile_partition_queue_segments()
+    {
+        // Without a dedicated compute queue family async compute passes run on the graphics queue
+        const auto has_async_compute = async_compute_queue_family_ != queue_family_;
+        position_segments_.resize(sorted_passes_.size());
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            const auto queue = has_async_compute ? passes_[sorted_passes_[position]].queue : PassQueue::Graphics;
+            if (segments_.empty() || segments_.back().queue != queue) {
+                segments_.push_back({.queue = queue, .first_position = position, .last_position = position});
+            }
+            segments_.back().last_position = position + 1;
+            position_segments_[position] = segments_.size() - 1;
+            if (queue == PassQueue::AsyncCompute) {
+                auto& pass = passes_[sorted_passes_[position]];
+                for (auto& access : pass.texture_accesses) {
+                    access.stage = to_compute_queue_stages(access.stage);
+                }
+                for (auto& access : pass.buffer_accesses) {
+                    access.stage = to_compute_queue_stages(access.stage);
+                }
+            }
+        }
+        // Final layout transitions and presentation happen on the graphics queue
+        if (segments_.empty() || segments_.back().queue != PassQueue::Graphics) {
+            segments_.push_back({.queue = PassQueue::Graphics, .first_position = sorted_passes_.size(), .last_position = sorted_passes_.size()});
+        }
+
+        // Wait for the latest segment on the other queue producing anything the segment depends on,
+        // earlier segments are covered by queue submission order
+        auto pass_positions = std::vector<std::size_t>(passes_.size(), no_pass);
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            pass_positions[sorted_passes_[position]] = position;
+        }
+        for (std::size_t segment = 0; segment < segments_.size(); ++segment) {
+            auto& queue_segment = segments_[segment];
+            for (auto position = queue_segment.first_position; position < queue_segment.last_position; ++position) {
+                for (auto dependency : passes_[sorted_passes_[position]].dependencies) {
+                    const auto dependency_segment = position_segments_[pass_positions[dependency]];
+                    if (segments_[dependency_segment].queue != queue_segment.queue) {
+                        queue_segment.wait_segment = std::max(queue_segment.wait_segment.value_or(0), dependency_segment);
+                    }
+                }
+            }
+        }
+        // The last segment signals frame completion, it has to complete after all compute work
+        auto last_compute_segment = std::ranges::find(segments_ | std::views::reverse, PassQueue::AsyncCompute, &QueueSegment::queue);
+        if (last_compute_segment != segments_.rend()) {
+            const auto compute_segment = static_cast<std::size_t>(segments_.rend() - last_compute_segment - 1);
+            segments_.back().wait_segment = std::max(segments_.back().wait_segment.value_or(0), compute_segment);
         }
     }
 
-    void RenderGraph::compile_increment_transient_resource_last_use()
+    void RenderGraph::compile_compute_transient_lifetimes()
     {
-        for (auto& [_, texture] : transient_textures_) {
-            ++texture.frames_since_use;
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            for (const auto& access : passes_[sorted_passes_[position]].texture_accesses) {
+                auto& texture = textures_[access.handle.index];
+                texture.first_use = std::min(texture.first_use, position);
+                texture.last_use = std::max(texture.last_use, position);
+                texture.async_compute_use |= segments_[position_segments_[position]].queue == PassQueue::AsyncCompute;
+            }
         }
     }
 
-    void RenderGraph::compile_allocate_transient_resources()
+    void RenderGraph::compile_build_rendering_scopes()
     {
-        for (auto& texture : textures_) {
-            // If imported texture, skip it
-            if (texture.lifetime == TextureLifetime::Persistent) {
+        position_scopes_.assign(sorted_passes_.size(), std::nullopt);
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            const auto& pass = passes_[sorted_passes_[position]];
+            if (!pass.render_area) {
                 continue;
             }
 
-            // Check if texture was cached
-            if (auto it = transient_textures_.find(texture.desc); it != transient_textures_.end()) {
-                texture.image = it->second.image;
-                texture.image_view = it->second.view;
-                // Mark resource as used in this frame
-                it->second.frames_since_use = 0;
-            } else {
-                // Allocate image
-                const auto image_info = VkImageCreateInfo{
-                    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-                    .pNext = nullptr,
-                    .flags = {},
-                    .imageType = texture.desc.image_type,
-                    .format = texture.desc.format,
-                    .extent = texture.desc.extent,
-                    .mipLevels = 1,
-                    .arrayLayers = 1,
-                    .samples = VK_SAMPLE_COUNT_1_BIT,
-                    .tiling = VK_IMAGE_TILING_OPTIMAL,
-                    .usage = texture.desc.usage,
-                    .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-                    .queueFamilyIndexCount = 0,
-                    .pQueueFamilyIndices = nullptr,
-                    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-                };
-                const auto allocation_info = VmaAllocationCreateInfo{
-                    .usage = VMA_MEMORY_USAGE_AUTO,
+            // Color attachments take slots in declaration order
+            auto color_attachments = std::vector<ScopeAttachment>{};
+            auto depth_attachment = std::optional<ScopeAttachment>{};
+            //  Resolve targets are written through the attachment they resolve
+            for (const auto& access : pass.texture_accesses) {
+                const auto is_resolve_target = std::ranges::any_of(pass.resolves, [&](const AttachmentResolve& resolve) { return resolve.target.index == access.handle.index; });
+                if (!is_attachment_access(access.access) || is_resolve_target) {
+                    continue;
+                }
+                const auto& ops = get_attachment_ops(position, access.handle);
+                auto attachment = ScopeAttachment{
+                    .handle = access.handle,
+                    .layout = access.layout,
+                    .load_op = ops.load_op,
+                    .store_op = ops.store_op,
+                    .clear_position = position,
                 };
-                VkImage image = VK_NULL_HANDLE;
-                VmaAllocation allocation = VK_NULL_HANDLE;
-                if (VkResult err = vmaCreateImage(vma_allocator_, &image_info, &allocation_info, &image, &allocation, nullptr)) {
-                    throw std::runtime_error(fmt::format("vmaCreateImage() failed: {}", string_VkResult(err)));
-                } else {
-                    ORION_RENDERER_LOG_INFO("Created VkImage {} with VmaAllocation {}", fmt::ptr(image), fmt::ptr(allocation));
+                const auto is_color = (access.access & (VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT)) != 0;
+                // Multiview renders view i into layer i of the attachment
+                ORION_ASSERT(get_subresource_range(access.handle).layerCount >= static_cast<std::uint32_t>(std::bit_width(pass.view_mask)));
+                const auto resolve = std::ranges::find(pass.resolves, access.handle.index, [](const AttachmentResolve& pass_resolve) { return pass_resolve.source.index; });
+                if (resolve != pass.resolves.end()) {
+                    ORION_ASSERT(is_color && textures_[access.handle.index].desc.samples != VK_SAMPLE_COUNT_1_BIT);
+                    ORION_ASSERT(textures_[resolve->target.index].desc.samples == VK_SAMPLE_COUNT_1_BIT);
+                    attachment.resolve_target = resolve->target;
+                    attachment.resolve_mode = resolve->mode;
+                }
+                if (!is_color) {
+                    depth_attachment = attachment;
+                } else if (std::ranges::none_of(color_attachments, [&](const ScopeAttachment& color) { return color.handle.index == attachment.handle.index; })) {
+                    color_attachments.push_back(attachment);
                 }
+            }
 
-                // Create image view
-                const auto image_view_info = VkImageViewCreateInfo{
-                    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-                    .pNext = nullptr,
-                    .flags = {},
-                    .image = image,
-                    .viewType = VK_IMAGE_VIEW_TYPE_2D,
-                    .format = texture.desc.format,
-                    .components = {}, // VK_COMPONENT_SWIZZLE_IDENTITY
-                    .subresourceRange = {
-                        .aspectMask = to_image_aspect_flags(texture.desc.format),
-                        .baseMipLevel = 0,
-                        .levelCount = VK_REMAINING_MIP_LEVELS,
-                        .baseArrayLayer = 0,
-                        .layerCount = VK_REMAINING_ARRAY_LAYERS,
-                    },
+            // Merge into the previous scope when the pass renders to the same area and attachments,
+            // it may leave out the depth attachment, and nothing but barriers between the attachments separates them
+            //  Resolves happen when the scope ends, a scope resolving attachments takes no further passes.
+            const auto can_merge = [&] {
+                if (position == 0 || !position_scopes_[position - 1] || position_segments_[position - 1] != position_segments_[position]) {
+                    return false;
+                }
+                const auto& scope = rendering_scopes_[*position_scopes_[position - 1]];
+                if (std::ranges::any_of(scope.color_attachments, [](const ScopeAttachment& color) { return color.resolve_target.has_value(); })) {
+                    return false;
+                }
+                const auto& scope_pass = passes_[sorted_passes_[scope.first_position]];
+                const auto& scope_area = *scope_pass.render_area;
+                if (scope_pass.view_mask != pass.view_mask) {
+                    return false;
+                }
+                if (scope_area.offset.x != pass.render_area->offset.x || scope_area.offset.y != pass.render_area->offset.y ||
+                    scope_area.extent.width != pass.render_area->extent.width || scope_area.extent.height != pass.render_area->extent.height) {
+                    return false;
+                }
+                const auto same_attachment = [this](const ScopeAttachment& lhs, const ScopeAttachment& rhs) {
+                    return lhs.handle.index == rhs.handle.index && lhs.layout == rhs.layout &&
+                           ranges_equal(get_subresource_range(lhs.handle), get_subresource_range(rhs.handle));
                 };
-                VkImageView view = VK_NULL_HANDLE;
-                if (VkResult err = vkCreateImageView(vk_device_, &image_view_info, nullptr, &view)) {
-                    vmaDestroyImage(vma_allocator_, image, allocation);
-                    throw std::runtime_error(fmt::format("vkCreateImageView() failed: {}", string_VkResult(err)));
-                } else {
-                    ORION_RENDERER_LOG_INFO("Created VkImageView {}", fmt::ptr(view));
+                if (!std::ranges::equal(scope.color_attachments, color_attachments, same_attachment) ||
+                    (depth_attachment && (!scope.depth_attachment || !same_attachment(*scope.depth_attachment, *depth_attachment)))) {
+                    return false;
+                }
+                const auto& batch = barrier_batches_[position];
+                if (!batch.signal_split_barriers.empty() || !batch.wait_events.empty() || !batch.buffer_barriers.empty()) {
+                    return false;
+                }
+                for (std::size_t i = 0; i < batch.image_barriers.size(); ++i) {
+                    const auto texture_idx = batch.image_barrier_textures[i];
+                    const auto is_scope_attachment = std::ranges::any_of(color_attachments, [&](const ScopeAttachment& color) { return color.handle.index == texture_idx; }) ||
+                                                     (scope.depth_attachment && scope.depth_attachment->handle.index == texture_idx);
+                    if ((!is_scope_attachment || batch.image_barriers[i].oldLayout != batch.image_barriers[i].newLayout) &&
+                        !is_hoistable_resolve_target(scope, position, texture_idx)) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            if (can_merge()) {
+                // Load with the first pass' ops, store with the last pass' ops
+                auto& scope = rendering_scopes_[*position_scopes_[position - 1]];
+                hoist_resolve_target_barriers(scope, position);
+                for (std::size_t slot = 0; slot < color_attachments.size(); ++slot) {
+                    scope.color_attachments[slot].store_op = color_attachments[slot].store_op;
+                    scope.color_attachments[slot].resolve_target = color_attachments[slot].resolve_target;
+                    scope.color_attachments[slot].resolve_mode = color_attachments[slot].resolve_mode;
+                }
+                if (depth_attachment) {
+                    scope.depth_attachment->store_op = depth_attachment->store_op;
                 }
+                scope.last_position = position + 1;
+                position_scopes_[position] = position_scopes_[position - 1];
+                continue;
+            }
+            rendering_scopes_.push_back({
+                .first_position = position,
+                .last_position = position + 1,
+                .color_attachments = std::move(color_attachments),
+                .depth_attachment = depth_attachment,
+            });
+            position_scopes_[position] = rendering_scopes_.size() - 1;
+        }
+    }
 
-                // Insert into cache
-                transient_textures_.emplace(std::make_pair(texture.desc, TextureAllocation{image, view, allocation}));
+    bool RenderGraph::is_hoistable_resolve_target(const RenderingScope& scope, std::size_t position, std::uint16_t texture_idx) const
+    {
+        // Untouched by the passes already in the scope, the barrier can move in front of the scope
+        const auto& pass = passes_[sorted_passes_[position]];
+        if (std::ranges::none_of(pass.resolves, [&](const AttachmentResolve& resolve) { return resolve.target.index == texture_idx; })) {
+            return false;
+        }
+        for (auto scope_position = scope.first_position; scope_position < position; ++scope_position) {
+            const auto& accesses = passes_[sorted_passes_[scope_position]].texture_accesses;
+            if (std::ranges::any_of(accesses, [&](const TextureAccess& access) { return access.handle.index == texture_idx; })) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-                // Mark non-virtual resource
-                texture.image = image;
-                texture.image_view = view;
+    void RenderGraph::hoist_resolve_target_barriers(const RenderingScope& scope, std::size_t position)
+    {
+        // Layout transitions of resolve targets run before the scope begins instead of between its passes
+        auto& batch = barrier_batches_[position];
+        auto& scope_batch = barrier_batches_[scope.first_position];
+        for (std::size_t i = 0; i < batch.image_barriers.size();) {
+            if (!is_hoistable_resolve_target(scope, position, batch.image_barrier_textures[i])) {
+                ++i;
+                continue;
             }
+            scope_batch.image_barriers.push_back(batch.image_barriers[i]);
+            scope_batch.image_barrier_textures.push_back(batch.image_barrier_textures[i]);
+            batch.image_barriers.erase(batch.image_barriers.begin() + static_cast<std::ptrdiff_t>(i));
+            batch.image_barrier_textures.erase(batch.image_barrier_textures.begin() + static_cast<std::ptrdiff_t>(i));
         }
     }
 
-    void RenderGraph::compile_emit_pass_barriers()
+    void RenderGraph::compile_infer_attachment_ops()
     {
-        for (auto pass_idx : sorted_passes_) {
-            auto& pass = passes_[pass_idx];
-            for (const auto& access : pass.texture_accesses) {
-                auto& entry = textures_[access.handle.index];
-                const auto src = TextureAccess{.layout = entry.current_layout, .stage = entry.last_stage, .access = entry.last_access};
-                if (requires_image_barrier(src, access)) {
-                    pass.image_barriers.push_back(VkImageMemoryBarrier2{
-                        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-                        .pNext = nullptr,
-                        .srcStageMask = src.stage,
-                        .srcAccessMask = src.access,
-                        .dstStageMask = access.stage,
-                        .dstAccessMask = access.access,
-                        .oldLayout = src.layout,
-                        .newLayout = access.layout,
-                        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                        .image = entry.image,
-                        .subresourceRange = {
-                            .aspectMask = to_image_aspect_flags(entry.desc.format),
-                            .baseMipLevel = 0,
-                            .levelCount = 1,
-                            .baseArrayLayer = 0,
-                            .layerCount = 1,
-                        },
+        attachment_ops_.assign(sorted_passes_.size(), {});
+
+        // Load what earlier passes wrote, imported textures bring their contents unless undefined
+        //  History images bring what a previous frame wrote into them
+        //  Store writes read by a later pass or leaving the graph, read-only attachments store nothing
+        //  Read-only attachments always load, clearing or discarding them would write in a read-only layout
+        //  Contents are tracked per subresource, attachments view a single mip level
+        auto has_contents = std::vector<std::vector<bool>>(textures_.size());
+        for (std::size_t texture_idx = 0; texture_idx < textures_.size(); ++texture_idx) {
+            const auto& texture = textures_[texture_idx];
+            const auto subresource_count = static_cast<std::size_t>(texture.desc.mip_levels) * texture.desc.array_layers;
+            if (const auto* history_image = texture.history_image) {
+                has_contents[texture_idx].resize(subresource_count);
+                for (std::size_t subresource = 0; subresource < subresource_count; ++subresource) {
+                    has_contents[texture_idx][subresource] = history_image->written_value != 0 &&
+                                                             history_image->subresource_states[subresource].layout != VK_IMAGE_LAYOUT_UNDEFINED;
+                }
+                continue;
+            }
+            const auto is_defined = texture.lifetime == ResourceLifetime::Persistent && texture.current_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+            has_contents[texture_idx].assign(subresource_count, is_defined);
+        }
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            auto& attachment_ops = attachment_ops_[position];
+            for (const auto& access : passes_[sorted_passes_[position]].texture_accesses) {
+                const auto texture_idx = access.handle.index;
+                const auto& texture = textures_[texture_idx];
+                if (is_attachment_access(access.access) &&
+                    std::ranges::find(attachment_ops, texture_idx, &AttachmentOps::texture) == attachment_ops.end()) {
+                    const auto is_read_later = texture.lifetime == ResourceLifetime::Persistent || texture.last_use > position;
+                    auto is_loaded = false;
+                    for_each_subresource(texture.desc, get_subresource_range(access.handle), [&](std::size_t subresource, const VkImageSubresourceRange&) {
+                        is_loaded = is_loaded || has_contents[texture_idx][subresource];
+                    });
+                    attachment_ops.push_back({
+                        .texture = texture_idx,
+                        .load_op = is_loaded || !is_write_access(access.access) ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
+                        .store_op = !is_write_access(access.access) ? VK_ATTACHMENT_STORE_OP_NONE
+                                    : is_read_later                 ? VK_ATTACHMENT_STORE_OP_STORE
+                                                                    : VK_ATTACHMENT_STORE_OP_DONT_CARE,
                     });
                 }
-                entry.current_layout = access.layout;
-                entry.last_stage = access.stage;
-                entry.last_access = access.access;
+            }
+            for (const auto& access : passes_[sorted_passes_[position]].texture_accesses) {
+                if (is_write_access(access.access)) {
+                    for_each_subresource(textures_[access.handle.index].desc, get_subresource_range(access.handle), [&](std::size_t subresource, const VkImageSubresourceRange&) {
+                        has_contents[access.handle.index][subresource] = true;
+                    });
+                }
+            }
+        }
+
+        // Attachments that are never sampled can live in lazily allocated memory when used by a single pass,
+        // or by a run of consecutive rendering passes usually sharing one rendering scope,
+        // like the passes drawing into a multisampled attachment before resolving it
+        static constexpr auto attachment_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                                 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                                 VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+        for (auto& texture : textures_) {
+            texture.lazily_allocated = texture.lifetime == ResourceLifetime::Transient && texture.referenced &&
+                                       (texture.desc.usage & ~attachment_usage) == 0;
+        }
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            for (const auto& access : passes_[sorted_passes_[position]].texture_accesses) {
+                if (!is_attachment_access(access.access) || (access.access & VK_ACCESS_2_SHADER_SAMPLED_READ_BIT) != 0) {
+                    textures_[access.handle.index].lazily_allocated = false;
+                }
+            }
+        }
+        for (std::size_t texture_idx = 0; texture_idx < textures_.size(); ++texture_idx) {
+            auto& texture = textures_[texture_idx];
+            if (!texture.lazily_allocated || texture.first_use == texture.last_use) {
+                continue;
+            }
+            for (auto position = texture.first_use; position <= texture.last_use && texture.lazily_allocated; ++position) {
+                const auto& pass = passes_[sorted_passes_[position]];
+                texture.lazily_allocated = pass.render_area.has_value() &&
+                                           std::ranges::any_of(pass.texture_accesses, [&](const TextureAccess& access) { return access.handle.index == texture_idx; });
             }
         }
     }
 
-    void RenderGraph::compile_emit_final_layout_transitions()
+    void RenderGraph::compile_allocate_transient_resources()
     {
-        for (const auto& texture : textures_) {
-            if (texture.lifetime == TextureLifetime::Persistent &&
-                texture.current_layout != texture.final_layout) {
-                final_layout_transitions_.push_back(VkImageMemoryBarrier2{
-                    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-                    .pNext = nullptr,
-                    .srcStageMask = texture.last_stage,
-                    .srcAccessMask = texture.last_access,
-                    .dstStageMask = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
-                    .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
-                    .oldLayout = texture.current_layout,
-                    .newLayout = texture.final_layout,
-                    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                    .image = texture.image,
-                    .subresourceRange = {
-                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                        .baseMipLevel = 0,
-                        .levelCount = 1,
-                        .baseArrayLayer = 0,
-                        .layerCount = 1,
-                    },
+        // Transient textures that need memory, in order of first use
+        std::vector<std::size_t> transient_textures;
+        for (std::size_t texture_idx = 0; texture_idx < textures_.size(); ++texture_idx) {
+            // If imported texture or only used by culled passes, skip it
+            if (textures_[texture_idx].lifetime == ResourceLifetime::Transient && textures_[texture_idx].referenced) {
+                transient_textures.push_back(texture_idx);
+            }
+        }
+        std::ranges::stable_sort(transient_textures, {}, [this](std::size_t texture_idx) { return textures_[texture_idx].first_use; });
+
+        // Assign textures to memory blocks
+        //  A block can be reused once the lifetime of the texture currently occupying it has ended.
+        //  Prefer the block that has to grow the least to fit the texture.
+        //  Lazily allocated attachments only share blocks with each other.
+        struct BlockAssignment {
+            VkMemoryRequirements requirements;
+            std::size_t occupant;
+            bool lazily_allocated;
+        };
+        std::vector<BlockAssignment> blocks;
+        for (std::size_t i = 0; i < transient_textures.size(); ++i) {
+            auto& texture = textures_[transient_textures[i]];
+            const auto requirements = get_memory_requirements(to_allocation_desc(texture));
+
+            auto best_block = std::optional<std::size_t>{};
+            auto best_growth = std::numeric_limits<VkDeviceSize>::max();
+            for (std::size_t block = 0; block < blocks.size(); ++block) {
+                const auto& assignment = blocks[block];
+                if (textures_[assignment.occupant].last_use >= texture.first_use ||
+                    textures_[assignment.occupant].async_compute_use || texture.async_compute_use ||
+                    assignment.lazily_allocated != texture.lazily_allocated ||
+                    (assignment.requirements.memoryTypeBits & requirements.memoryTypeBits) == 0) {
+                    continue;
+                }
+                const auto growth = requirements.size > assignment.requirements.size ? requirements.size - assignment.requirements.size : 0;
+                if (growth < best_growth) {
+                    best_block = block;
+                    best_growth = growth;
+                }
+            }
+
+            if (!best_block) {
+                best_block = blocks.size();
+                blocks.push_back({requirements, transient_textures[i], texture.lazily_allocated});
+            } else {
+                auto& assignment = blocks[*best_block];
+                texture.aliased_texture = assignment.occupant;
+                assignment.requirements.size = std::max(assignment.requirements.size, requirements.size);
+                assignment.requirements.alignment = std::max(assignment.requirements.alignment, requirements.alignment);
+                assignment.requirements.memoryTypeBits &= requirements.memoryTypeBits;
+                assignment.occupant = transient_textures[i];
+            }
+            texture.memory_block = *best_block;
+        }
+
+        // Memory is taken from the heap for every frame, only the requirements are kept with the compiled graph
+        transient_blocks_.clear();
+        for (const auto& block : blocks) {
+            transient_blocks_.push_back({block.requirements, block.lazily_allocated});
+        }
+
+        // Views of the subresource ranges passes access through mip and layer handles, created once memory is bound
+        for (const auto texture_idx : transient_textures) {
+            auto& texture = textures_[texture_idx];
+            for (const auto& pass : passes_) {
+                if (pass.culled) {
+                    continue;
+                }
+                for (const auto& access : pass.texture_accesses) {
+                    if (access.handle.index != texture_idx) {
+                        continue;
+                    }
+                    const auto range = get_subresource_range(access.handle);
+                    const auto is_whole = range.levelCount == texture.desc.mip_levels && range.layerCount == texture.desc.array_layers;
+                    const auto has_view = std::ranges::any_of(texture.subresource_views, [&](const SubresourceView& view) { return ranges_equal(view.range, range); });
+                    if (!is_whole && !has_view) {
+                        texture.subresource_views.push_back({range, VK_NULL_HANDLE});
+                    }
+                }
+            }
+        }
+    }
+
+    void RenderGraph::compile_emit_pass_barriers()
+    {
+        barrier_batches_.resize(sorted_passes_.size() + 1);
+
+        // Every subresource starts in the layout the texture was declared with,
+        // history images continue from the last access of the previous frame using them
+        for (auto& texture : textures_) {
+            if (texture.history_image) {
+                texture.subresource_states = texture.history_image->subresource_states;
+                continue;
+            }
+            const auto subresource_count = static_cast<std::size_t>(texture.desc.mip_levels) * texture.desc.array_layers;
+            texture.subresource_states.assign(subresource_count, SubresourceState{.layout = texture.current_layout});
+        }
+
+        // Merge accesses to the same subresources within a pass, they are not ordered against each other
+        struct SubresourceAccess {
+            TextureAccess access;
+            VkImageSubresourceRange range;
+        };
+        auto pass_accesses = std::vector<std::vector<SubresourceAccess>>(sorted_passes_.size());
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            auto& merged_accesses = pass_accesses[position];
+            for (const auto& access : passes_[sorted_passes_[position]].texture_accesses) {
+                const auto range = get_subresource_range(access.handle);
+                auto it = std::ranges::find_if(merged_accesses, [&](const SubresourceAccess& merged) {
+                    return merged.access.handle.index == access.handle.index && ranges_overlap(merged.range, range);
+                });
+                if (it == merged_accesses.end()) {
+                    merged_accesses.push_back({access, range});
+                } else {
+                    // Overlapping accesses within a pass have to view the same subresources in the same layout
+                    ORION_ASSERT(ranges_equal(it->range, range));
+                    ORION_ASSERT(it->access.layout == access.layout);
+                    it->access.stage |= access.stage;
+                    it->access.access |= access.access;
+                }
+            }
+        }
+
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            for (const auto& [pass_access, range] : pass_accesses[position]) {
+                const auto texture_idx = pass_access.handle.index;
+                auto& entry = textures_[texture_idx];
+                for_each_subresource(entry.desc, range, [&](std::size_t subresource, const VkImageSubresourceRange& subresource_range) {
+                    auto& state = entry.subresource_states[subresource];
+                    auto access = pass_access;
+                    auto src = TextureAccess{.layout = state.layout, .stage = state.last_stage, .access = state.last_access};
+                    auto src_position = state.last_position;
+                    // First use of memory previously occupied by another transient texture,
+                    // wait for all accesses of the previous occupant and discard its contents
+                    if (entry.aliased_texture && state.last_stage == VK_PIPELINE_STAGE_2_NONE) {
+                        src_position = no_pass;
+                        for (const auto& previous : textures_[*entry.aliased_texture].subresource_states) {
+                            src.stage |= previous.last_stage;
+                            src.access |= previous.last_access;
+                            if (previous.last_position != no_pass) {
+                                src_position = src_position == no_pass ? previous.last_position : std::max(src_position, previous.last_position);
+                            }
+                        }
+                    }
+                    // Moving to another queue family transfers ownership, even between reads
+                    const auto crosses_queue = src_position != no_pass && position_queue_family(src_position) != position_queue_family(position);
+                    if (crosses_queue || requires_image_barrier(src, access)) {
+                        // Make the subresource visible to the following readers in the same layout as well,
+                        // they then need no barrier of their own
+                        if (!is_write_access(access.access)) {
+                            for (std::size_t next = position + 1; next < sorted_passes_.size(); ++next) {
+                                auto it = std::ranges::find_if(pass_accesses[next], [&](const SubresourceAccess& next_access) {
+                                    return next_access.access.handle.index == texture_idx && ranges_overlap(next_access.range, subresource_range);
+                                });
+                                if (it == pass_accesses[next].end()) {
+                                    continue;
+                                }
+                                if (!is_read_after_read(access, it->access) || position_queue_family(next) != position_queue_family(position)) {
+                                    break;
+                                }
+                                access.stage |= it->access.stage;
+                                access.access |= it->access.access;
+                            }
+                        }
+
+                        const auto barrier = VkImageMemoryBarrier2{
+                            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                            .pNext = nullptr,
+                            .srcStageMask = src.stage,
+                            .srcAccessMask = src.access,
+                            .dstStageMask = access.stage,
+                            .dstAccessMask = access.access,
+                            .oldLayout = src.layout,
+                            .newLayout = access.layout,
+                            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                            .image = entry.image,
+                            .subresourceRange = subresource_range,
+                        };
+                        if (crosses_queue) {
+                            // Release at the end of the producing segment, acquire before the consumer
+                            auto& release_batch = segments_[position_segments_[src_position]].release_batch;
+                            auto release = barrier;
+                            release.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+                            release.dstAccessMask = VK_ACCESS_2_NONE;
+                            release.srcQueueFamilyIndex = position_queue_family(src_position);
+                            release.dstQueueFamilyIndex = position_queue_family(position);
+                            push_image_barrier(release_batch.image_barriers, release_batch.image_barrier_textures, release, texture_idx);
+                            auto acquire = barrier;
+                            acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+                            acquire.srcAccessMask = VK_ACCESS_2_NONE;
+                            acquire.srcQueueFamilyIndex = release.srcQueueFamilyIndex;
+                            acquire.dstQueueFamilyIndex = release.dstQueueFamilyIndex;
+                            auto& batch = barrier_batches_[position];
+                            push_image_barrier(batch.image_barriers, batch.image_barrier_textures, acquire, texture_idx);
+                        } else if (src_position != no_pass && position > src_position + 1 &&
+                                   position_segments_[src_position] == position_segments_[position]) {
+                            // Split the barrier when there is independent work between producer and consumer
+                            auto& split_barrier = get_split_barrier(src_position, position);
+                            push_image_barrier(split_barrier.image_barriers, split_barrier.image_barrier_textures, barrier, texture_idx);
+                        } else {
+                            auto& batch = barrier_batches_[position];
+                            push_image_barrier(batch.image_barriers, batch.image_barrier_textures, barrier, texture_idx);
+                        }
+
+                        state.layout = access.layout;
+                        state.last_stage = access.stage;
+                        state.last_access = access.access;
+                    } else {
+                        // Accumulate readers so the next write waits for all of them
+                        state.last_stage |= access.stage;
+                        state.last_access |= access.access;
+                    }
+                    state.last_position = position;
                 });
             }
         }
     }
+
+    void RenderGraph::compile_emit_buffer_barriers()
+    {
+        // Merge accesses to the same buffer within a pass, they are not ordered against each other
+        auto pass_accesses = std::vector<std::vector<BufferAccess>>(sorted_passes_.size());
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            for (const auto& access : passes_[sorted_passes_[position]].buffer_accesses) {
+                auto& merged_accesses = pass_accesses[position];
+                auto it = std::ranges::find(merged_accesses, access.handle.index, [](const BufferAccess& merged) { return merged.handle.index; });
+                if (it == merged_accesses.end()) {
+                    merged_accesses.push_back(access);
+                } else {
+                    it->stage |= access.stage;
+                    it->access |= access.access;
+                }
+            }
+        }
+
+        // Position of the pass that last accessed each buffer
+        auto last_positions = std::vector<std::size_t>(buffers_.size(), no_pass);
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            for (auto access : pass_accesses[position]) {
+                auto& entry = buffers_[access.handle.index];
+                // Buffers have no layout, only writes after earlier accesses in the graph need ordering
+                //  Imported buffers are owned by the queue family first accessing them
+                const auto src_position = last_positions[access.handle.index];
+                const auto has_previous_access = entry.last_stage != VK_PIPELINE_STAGE_2_NONE;
+                const auto crosses_queue = src_position != no_pass && position_queue_family(src_position) != position_queue_family(position);
+                if (has_previous_access && (crosses_queue || is_write_access(entry.last_access) || is_write_access(access.access))) {
+                    // Make the buffer visible to the following readers as well
+                    if (!is_write_access(access.access)) {
+                        for (std::size_t next = position + 1; next < sorted_passes_.size(); ++next) {
+                            auto it = std::ranges::find(pass_accesses[next], access.handle.index, [](const BufferAccess& next_access) { return next_access.handle.index; });
+                            if (it == pass_accesses[next].end()) {
+                                continue;
+                            }
+                            if (is_write_access(it->access) || position_queue_family(next) != position_queue_family(position)) {
+                                break;
+                            }
+                            access.stage |= it->stage;
+                            access.access |= it->access;
+                        }
+                    }
+
+                    const auto barrier = VkBufferMemoryBarrier2{
+                        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+                        .pNext = nullptr,
+                        .srcStageMask = entry.last_stage,
+                        .srcAccessMask = entry.last_access,
+                        .dstStageMask = access.stage,
+                        .dstAccessMask = access.access,
+                        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                        .buffer = entry.buffer,
+                        .offset = 0,
+                        .size = VK_WHOLE_SIZE,
+                    };
+                    if (crosses_queue) {
+                        // Release at the end of the producing segment, acquire before the consumer
+                        auto& release_batch = segments_[position_segments_[src_position]].release_batch;
+                        auto release = barrier;
+                        release.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+                        release.dstAccessMask = VK_ACCESS_2_NONE;
+                        release.srcQueueFamilyIndex = position_queue_family(src_position);
+                        release.dstQueueFamilyIndex = position_queue_family(position);
+                        release_batch.buffer_barriers.push_back(release);
+                        release_batch.buffer_barrier_buffers.push_back(access.handle.index);
+                        auto acquire = barrier;
+                        acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+                        acquire.srcAccessMask = VK_ACCESS_2_NONE;
+                        acquire.srcQueueFamilyIndex = release.srcQueueFamilyIndex;
+                        acquire.dstQueueFamilyIndex = release.dstQueueFamilyIndex;
+                        barrier_batches_[position].buffer_barriers.push_back(acquire);
+                        barrier_batches_[position].buffer_barrier_buffers.push_back(access.handle.index);
+                    } else if (src_position != no_pass && position > src_position + 1 &&
+                               position_segments_[src_position] == position_segments_[position]) {
+                        // Split the barrier when there is independent work between producer and consumer
+                        auto& split_barrier = get_split_barrier(src_position, position);
+                        split_barrier.buffer_barriers.push_back(barrier);
+                        split_barrier.buffer_barrier_buffers.push_back(access.handle.index);
+                    } else {
+                        barrier_batches_[position].buffer_barriers.push_back(barrier);
+                        barrier_batches_[position].buffer_barrier_buffers.push_back(access.handle.index);
+                    }
+
+                    entry.last_stage = access.stage;
+                    entry.last_access = access.access;
+                } else {
+                    // First access or read after read, accumulate so the next write waits for all readers
+                    entry.last_stage |= access.stage;
+                    entry.last_access |= access.access;
+                }
+                last_positions[access.handle.index] = position;
+            }
+        }
+    }
+
+    void RenderGraph::compile_emit_final_layout_transitions()
+    {
+        for (std::size_t texture_idx = 0; texture_idx < textures_.size(); ++texture_idx) {
+            auto& texture = textures_[texture_idx];
+            if (texture.lifetime != ResourceLifetime::Persistent) {
+                continue;
+            }
+            const auto whole_range = get_subresource_range({static_cast<std::uint16_t>(texture_idx)});
+            for_each_subresource(texture.desc, whole_range, [&](std::size_t subresource, const VkImageSubresourceRange& subresource_range) {
+                auto& state = texture.subresource_states[subresource];
+                const auto is_used = state.last_position != no_pass;
+                // History images stay in their layout for the next frame, only returning to the graphics queue
+                const auto final_layout = texture.history_image ? state.layout : texture.final_layout;
+                const auto used_on_other_queue = is_used && position_queue_family(state.last_position) != queue_family_;
+                if (state.layout == final_layout && !(texture.history_image && used_on_other_queue)) {
+                    return;
+                }
+                // Transition right after the last pass using the subresource, batched with that point's barriers
+                //  Imported textures are handed back on the graphics queue
+                auto position = is_used ? state.last_position + 1 : 0;
+                if (position < sorted_passes_.size() && position_queue_family(position) != queue_family_) {
+                    position = sorted_passes_.size();
+                }
+                const auto [dst_stage, dst_access] = to_final_stage_access(final_layout);
+                const auto src_queue_family = is_used ? position_queue_family(state.last_position) : queue_family_;
+                if (src_queue_family != queue_family_) {
+                    auto& release_batch = segments_[position_segments_[state.last_position]].release_batch;
+                    const auto release = VkImageMemoryBarrier2{
+                        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                        .pNext = nullptr,
+                        .srcStageMask = state.last_stage,
+                        .srcAccessMask = state.last_access,
+                        .dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+                        .dstAccessMask = VK_ACCESS_2_NONE,
+                        .oldLayout = state.layout,
+                        .newLayout = final_layout,
+                        .srcQueueFamilyIndex = src_queue_family,
+                        .dstQueueFamilyIndex = queue_family_,
+                        .image = texture.image,
+                        .subresourceRange = subresource_range,
+                    };
+                    push_image_barrier(release_batch.image_barriers, release_batch.image_barrier_textures, release, static_cast<std::uint16_t>(texture_idx));
+                    position = sorted_passes_.size();
+                }
+                const auto acquires_ownership = src_queue_family != queue_family_;
+                const auto barrier = VkImageMemoryBarrier2{
+                    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                    .pNext = nullptr,
+                    .srcStageMask = acquires_ownership ? VK_PIPELINE_STAGE_2_NONE : state.last_stage,
+                    .srcAccessMask = acquires_ownership ? VK_ACCESS_2_NONE : state.last_access,
+                    .dstStageMask = dst_stage,
+                    .dstAccessMask = dst_access,
+                    .oldLayout = state.layout,
+                    .newLayout = final_layout,
+                    .srcQueueFamilyIndex = acquires_ownership ? src_queue_family : VK_QUEUE_FAMILY_IGNORED,
+                    .dstQueueFamilyIndex = acquires_ownership ? queue_family_ : VK_QUEUE_FAMILY_IGNORED,
+                    .image = texture.image,
+                    .subresourceRange = subresource_range,
+                };
+                auto& batch = barrier_batches_[position];
+                push_image_barrier(batch.image_barriers, batch.image_barrier_textures, barrier, static_cast<std::uint16_t>(texture_idx));
+                state.layout = final_layout;
+                state.last_stage = dst_stage;
+                state.last_access = dst_access;
+            });
+        }
+    }
+
+    void RenderGraph::update_history_images()
+    {
+        for (std::size_t texture_idx = 0; texture_idx < textures_.size(); ++texture_idx) {
+            auto& texture = textures_[texture_idx];
+            if (!texture.history_image) {
+                continue;
+            }
+            auto& history_image = *texture.history_image;
+
+            // Views of the subresource ranges passes access, the compiled graph may have been compiled for another image
+            for (auto pass_idx : sorted_passes_) {
+                for (const auto& access : passes_[pass_idx].texture_accesses) {
+                    const auto range = get_subresource_range(access.handle);
+                    if (access.handle.index == texture_idx && (range.levelCount != texture.desc.mip_levels || range.layerCount != texture.desc.array_layers)) {
+                        transient_heap_->get_image_view(history_image, texture.desc, range);
+                    }
+                }
+            }
+
+            // Graphs are compiled in submission order, the next frame using the image continues from here
+            history_image.subresource_states = texture.subresource_states;
+            for (auto& state : history_image.subresource_states) {
+                state.last_position = no_pass;
+            }
+            const auto is_written = std::ranges::any_of(sorted_passes_, [&](std::size_t pass_idx) {
+                return std::ranges::any_of(passes_[pass_idx].texture_accesses, [&](const TextureAccess& access) {
+                    return access.handle.index == texture_idx && is_write_access(access.access);
+                });
+            });
+            if (is_written) {
+                history_image.written_value = frame_value_;
+            }
+        }
+    }
+
+    void RenderGraph::compile_link_split_barriers()
+    {
+        // Barrier vectors are final, point the batches at them
+        for (std::size_t i = 0; i < split_barriers_.size(); ++i) {
+            const auto& split_barrier = split_barriers_[i];
+            barrier_batches_[split_barrier.signal_position + 1].signal_split_barriers.push_back(i);
+            auto& wait_batch = barrier_batches_[split_barrier.wait_position];
+            wait_batch.wait_events.push_back(split_barrier.event);
+            wait_batch.wait_dependencies.push_back(to_dependency_info(split_barrier.buffer_barriers, split_barrier.image_barriers));
+        }
+    }
+
+    VkMemoryRequirements RenderGraph::get_memory_requirements(const TextureDesc& desc) const
+    {
+        const auto image_info = to_image_create_info(desc);
+        const auto requirements_info = VkDeviceImageMemoryRequirements{
+            .sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+            .pNext = nullptr,
+            .pCreateInfo = &image_info,
+            .planeAspect = {},
+        };
+        auto requirements = VkMemoryRequirements2{.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+        vkGetDeviceImageMemoryRequirements(vk_device_, &requirements_info, &requirements);
+        return requirements.memoryRequirements;
+    }
+
+    RenderGraph::SplitBarrier& RenderGraph::get_split_barrier(std::size_t signal_position, std::size_t wait_position)
+    {
+        // Barriers between the same pair of passes share an event
+        auto it = std::ranges::find_if(split_barriers_, [&](const SplitBarrier& split_barrier) {
+            return split_barrier.signal_position == signal_position && split_barrier.wait_position == wait_position;
+        });
+        if (it != split_barriers_.end()) {
+            return *it;
+        }
+
+        // Events are pooled, one per split barrier in the frame
+        if (events_.size() == split_barriers_.size()) {
+            const auto event_info = VkEventCreateInfo{
+                .sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = VK_EVENT_CREATE_DEVICE_ONLY_BIT,
+            };
+            VkEvent event = VK_NULL_HANDLE;
+            if (VkResult err = vkCreateEvent(vk_device_, &event_info, nullptr, &event)) {
+                throw std::runtime_error(fmt::format("vkCreateEvent() failed: {}", string_VkResult(err)));
+            } else {
+                ORION_RENDERER_LOG_INFO("Created VkEvent {}", fmt::ptr(event));
+            }
+            events_.push_back(event);
+        }
+        return split_barriers_.emplace_back(SplitBarrier{
+            .event = events_[split_barriers_.size()],
+            .signal_position = signal_position,
+            .wait_position = wait_position,
+        });
+    }
+
+    std::string RenderGraph::to_dot() const
+    {
+        // Passes are boxes grouped by queue segment, resource versions are ellipses between them
+        //  Transient textures are filled with the color of their memory block, aliasing textures share it.
+        std::string out;
+        auto it = std::back_inserter(out);
+        out += "digraph render_graph {\n    rankdir=LR;\n    node [fontname=\"monospace\"];\n";
+
+        for (std::size_t segment = 0; segment < segments_.size(); ++segment) {
+            const auto& queue_segment = segments_[segment];
+            fmt::format_to(it, "    subgraph cluster_segment_{} {{\n        label=\"Segment {} ({})\";\n", segment, segment, to_string(queue_segment.queue));
+            for (auto position = queue_segment.first_position; position < queue_segment.last_position; ++position) {
+                const auto& batch = barrier_batches_[position];
+                const auto wait_count = std::ranges::count(split_barriers_, position, &SplitBarrier::wait_position);
+                fmt::format_to(it, "        pass_{} [shape=box,label=\"{}: {}\\n{} image / {} buffer barriers, {} waits\"];\n",
+                               position, position, escape_string(passes_[sorted_passes_[position]].name),
+                               batch.image_barriers.size(), batch.buffer_barriers.size(), wait_count);
+            }
+            out += "    }\n";
+        }
+        for (const auto& pass : passes_) {
+            if (pass.culled) {
+                fmt::format_to(it, "    \"culled_{}\" [shape=box,style=dashed,label=\"{} (culled)\"];\n", escape_string(pass.name), escape_string(pass.name));
+            }
+        }
+
+        for (std::size_t texture_idx = 0; texture_idx < textures_.size(); ++texture_idx) {
+            const auto& texture = textures_[texture_idx];
+            if (!texture.referenced) {
+                continue;
+            }
+            // Every version of the texture accessed by a live pass
+            auto versions = std::set<std::uint16_t>{};
+            for (auto pass_idx : sorted_passes_) {
+                for (const auto& access : passes_[pass_idx].texture_accesses) {
+                    if (access.handle.index == texture_idx) {
+                        versions.insert(access.handle.version);
+                        if (is_write_access(access.access)) {
+                            versions.insert(static_cast<std::uint16_t>(access.handle.version + 1));
+                        }
+                    }
+                }
+            }
+            const auto style = texture.memory_block ? fmt::format(",style=filled,fillcolor=\"/set312/{}\"", *texture.memory_block % 12 + 1) : std::string{};
+            const auto memory = texture.memory_block ? fmt::format("\\nblock {}, {} bytes", *texture.memory_block, get_memory_requirements(to_allocation_desc(texture)).size) : std::string{};
+            for (auto version : versions) {
+                fmt::format_to(it, "    texture_{}_{} [label=\"texture {} v{}\\n{} {}x{}{}\"{}];\n",
+                               texture_idx, version, texture_idx, version, string_VkFormat(texture.desc.format),
+                               texture.desc.extent.width, texture.desc.extent.height, memory, style);
+            }
+        }
+        for (std::size_t buffer_idx = 0; buffer_idx < buffers_.size(); ++buffer_idx) {
+            const auto& buffer = buffers_[buffer_idx];
+            if (!buffer.referenced) {
+                continue;
+            }
+            auto versions = std::set<std::uint16_t>{};
+            for (auto pass_idx : sorted_passes_) {
+                for (const auto& access : passes_[pass_idx].buffer_accesses) {
+                    if (access.handle.index == buffer_idx) {
+                        versions.insert(access.handle.version);
+                        if (is_write_access(access.access)) {
+                            versions.insert(static_cast<std::uint16_t>(access.handle.version + 1));
+                        }
+                    }
+                }
+            }
+            for (auto version : versions) {
+                fmt::format_to(it, "    buffer_{}_{} [shape=cylinder,label=\"buffer {} v{}\\n{} bytes\"];\n",
+                               buffer_idx, version, buffer_idx, version, buffer.desc.size);
+            }
+        }
+
+        // Reads point into the pass, writes point to the version they produce
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            const auto& pass = passes_[sorted_passes_[position]];
+            for (const auto& access : pass.texture_accesses) {
+                const auto range = get_subresource_range(access.handle);
+                const auto label = fmt::format("{} mip {}+{} layer {}+{}", string_VkImageLayout(access.layout),
+                                               range.baseMipLevel, range.levelCount, range.baseArrayLayer, range.layerCount);
+                if (is_write_access(access.access)) {
+                    fmt::format_to(it, "    pass_{} -> texture_{}_{} [label=\"{}\"];\n", position, access.handle.index, access.handle.version + 1, label);
+                } else {
+                    fmt::format_to(it, "    texture_{}_{} -> pass_{} [label=\"{}\"];\n", access.handle.index, access.handle.version, position, label);
+                }
+            }
+            for (const auto& access : pass.buffer_accesses) {
+                if (is_write_access(access.access)) {
+                    fmt::format_to(it, "    pass_{} -> buffer_{}_{};\n", position, access.handle.index, access.handle.version + 1);
+                } else {
+                    fmt::format_to(it, "    buffer_{}_{} -> pass_{};\n", access.handle.index, access.handle.version, position);
+                }
+            }
+        }
+        for (const auto& split_barrier : split_barriers_) {
+            fmt::format_to(it, "    pass_{} -> pass_{} [style=dashed,label=\"split barrier\"];\n", split_barrier.signal_position, split_barrier.wait_position);
+        }
+        out += "}\n";
+        return out;
+    }
+
+    std::string RenderGraph::to_json() const
+    {
+        std::string out;
+        auto it = std::back_inserter(out);
+
+        out += "{\"passes\":[";
+        for (std::size_t position = 0; position < sorted_passes_.size(); ++position) {
+            const auto& pass = passes_[sorted_passes_[position]];
+            const auto scope = position_scopes_[position];
+            fmt::format_to(it, R"({}{{"position":{},"name":"{}","queue":"{}","segment":{},"rendering_scope":{},"view_mask":{},"textures":[)",
+                           position == 0 ? "" : ",", position, escape_string(pass.name), to_string(pass.queue),
+                           position_segments_[position], scope ? std::to_string(*scope) : "null", pass.view_mask);
+            for (std::size_t i = 0; i < pass.texture_accesses.size(); ++i) {
+                const auto& access = pass.texture_accesses[i];
+                const auto range = get_subresource_range(access.handle);
+                fmt::format_to(it, R"({}{{"texture":{},"version":{},"write":{},"layout":"{}","stage":"{}","access":"{}",)"
+                                   R"("base_mip_level":{},"mip_level_count":{},"base_array_layer":{},"array_layer_count":{}}})",
+                               i == 0 ? "" : ",", access.handle.index, access.handle.version, is_write_access(access.access),
+                               string_VkImageLayout(access.layout), string_VkPipelineStageFlags2(access.stage), string_VkAccessFlags2(access.access),
+                               range.baseMipLevel, range.levelCount, range.baseArrayLayer, range.layerCount);
+            }
+            out += "],\"buffers\":[";
+            for (std::size_t i = 0; i < pass.buffer_accesses.size(); ++i) {
+                const auto& access = pass.buffer_accesses[i];
+                fmt::format_to(it, R"({}{{"buffer":{},"version":{},"write":{},"stage":"{}","access":"{}"}})",
+                               i == 0 ? "" : ",", access.handle.index, access.handle.version, is_write_access(access.access),
+                               string_VkPipelineStageFlags2(access.stage), string_VkAccessFlags2(access.access));
+            }
+            // Barriers recorded in front of the pass
+            const auto& batch = barrier_batches_[position];
+            out += "],";
+            append_json_barriers(out, batch.buffer_barriers, batch.buffer_barrier_buffers, batch.image_barriers, batch.image_barrier_textures);
+            out += "}";
+        }
+
+        out += "],\"culled_passes\":[";
+        auto first = true;
+        for (const auto& pass : passes_) {
+            if (pass.culled) {
+                fmt::format_to(it, R"({}"{}")", first ? "" : ",", escape_string(pass.name));
+                first = false;
+            }
+        }
+
+        // Barriers after the last pass, final layout transitions of imported textures
+        out += "],\"final_barriers\":{";
+        if (!barrier_batches_.empty()) {
+            const auto& batch = barrier_batches_.back();
+            append_json_barriers(out, batch.buffer_barriers, batch.buffer_barrier_buffers, batch.image_barriers, batch.image_barrier_textures);
+        }
+
+        out += "},\"split_barriers\":[";
+        for (std::size_t i = 0; i < split_barriers_.size(); ++i) {
+            const auto& split_barrier = split_barriers_[i];
+            fmt::format_to(it, R"({}{{"signal_position":{},"wait_position":{},)", i == 0 ? "" : ",", split_barrier.signal_position, split_barrier.wait_position);
+            append_json_barriers(out, split_barrier.buffer_barriers, split_barrier.buffer_barrier_buffers, split_barrier.image_barriers, split_barrier.image_barrier_textures);
+            out += "}";
+        }
+
+        out += "],\"queue_segments\":[";
+        for (std::size_t segment = 0; segment < segments_.size(); ++segment) {
+            const auto& queue_segment = segments_[segment];
+            fmt::format_to(it, R"({}{{"queue":"{}","first_position":{},"last_position":{},"wait_segment":{},"release_barriers":{{)",
+                           segment == 0 ? "" : ",", to_string(queue_segment.queue), queue_segment.first_position, queue_segment.last_position,
+                           queue_segment.wait_segment ? std::to_string(*queue_segment.wait_segment) : "null");
+            const auto& batch = queue_segment.release_batch;
+            append_json_barriers(out, batch.buffer_barriers, batch.buffer_barrier_buffers, batch.image_barriers, batch.image_barrier_textures);
+            out += "}}";
+        }
+
+        out += "],\"textures\":[";
+        for (std::size_t texture_idx = 0; texture_idx < textures_.size(); ++texture_idx) {
+            const auto& texture = textures_[texture_idx];
+            // Memory the texture needs on its own, its block may be larger to fit the other textures aliasing it
+            const auto memory_size = texture.memory_block ? get_memory_requirements(to_allocation_desc(texture)).size : 0;
+            fmt::format_to(it, R"({}{{"texture":{},"lifetime":"{}","format":"{}","width":{},"height":{},"depth":{},"mip_levels":{},"array_layers":{},"samples":{},)"
+                               R"("referenced":{},"first_use":{},"last_use":{},"lazily_allocated":{},"history":{},"memory_block":{},"memory_size":{}}})",
+                           texture_idx == 0 ? "" : ",", texture_idx, to_string(texture.lifetime), string_VkFormat(texture.desc.format),
+                           texture.desc.extent.width, texture.desc.extent.height, texture.desc.extent.depth,
+                           texture.desc.mip_levels, texture.desc.array_layers, static_cast<std::uint32_t>(texture.desc.samples), texture.referenced,
+                           texture.referenced ? std::to_string(texture.first_use) : "null",
+                           texture.referenced ? std::to_string(texture.last_use) : "null",
+                           texture.lazily_allocated, texture.history_image != nullptr, texture.memory_block ? std::to_string(*texture.memory_block) : "null", memory_size);
+        }
+
+        out += "],\"buffers\":[";
+        for (std::size_t buffer_idx = 0; buffer_idx < buffers_.size(); ++buffer_idx) {
+            const auto& buffer = buffers_[buffer_idx];
+            fmt::format_to(it, R"({}{{"buffer":{},"lifetime":"{}","size":{},"referenced":{}}})",
+                           buffer_idx == 0 ? "" : ",", buffer_idx, to_string(buffer.lifetime), buffer.desc.size, buffer.referenced);
+        }
+
+        // Aliasing groups, textures placed in the same block have disjoint lifetimes
+        out += "],\"memory_blocks\":[";
+        VkDeviceSize total_size = 0;
+        for (std::size_t block = 0; block < transient_blocks_.size(); ++block) {
+            const auto& memory_block = transient_blocks_[block];
+            total_size += memory_block.requirements.size;
+            fmt::format_to(it, R"({}{{"memory_block":{},"size":{},"lazily_allocated":{},"textures":[)",
+                           block == 0 ? "" : ",", block, memory_block.requirements.size, memory_block.lazily_allocated);
+            first = true;
+            for (std::size_t texture_idx = 0; texture_idx < textures_.size(); ++texture_idx) {
+                if (textures_[texture_idx].memory_block == block) {
+                    fmt::format_to(it, "{}{}", first ? "" : ",", texture_idx);
+                    first = false;
+                }
+            }
+            out += "]}";
+        }
+        fmt::format_to(it, R"(],"transient_memory_size":{}}})", total_size);
+        out += "\n";
+        return out;
+    }
+
+    std::uint32_t RenderGraph::queue_family_index(PassQueue queue) const
+    {
+        switch (queue) {
+            case PassQueue::Graphics:
+                return queue_family_;
+            case PassQueue::AsyncCompute:
+                return async_compute_queue_family_;
+        }
+        unreachable();
+    }
+
+    std::uint32_t RenderGraph::position_queue_family(std::size_t position) const
+    {
+        return queue_family_index(segments_[position_segments_[position]].queue);
+    }
+
+    std::size_t RenderGraph::timestamp_position_end(std::size_t first_position, std::size_t last_position) const
+    {
+        // Positions of a range run on the same queue, the timed ones are a prefix of the range
+        if (!timestamp_queries_ || first_position == last_position) {
+            return first_position;
+        }
+        const auto queue = segments_[position_segments_[first_position]].queue;
+        const auto queue_timestamps = queue == PassQueue::Graphics ? timestamp_queries_->graphics_timestamps : timestamp_queries_->async_compute_timestamps;
+        if (!queue_timestamps) {
+            return first_position;
+        }
+        return std::clamp<std::size_t>(timestamp_queries_->query_count / 2, first_position, last_position);
+    }
+
+    std::optional<std::size_t> RenderGraph::multiview_scope(std::size_t position) const
+    {
+        const auto scope = position_scopes_[position];
+        if (!scope || passes_[sorted_passes_[rendering_scopes_[*scope].first_position]].view_mask == 0) {
+            return std::nullopt;
+        }
+        return scope;
+    }
+
+    void RenderGraph::record_segment(VkCommandBuffer command_buffer, std::size_t segment, std::uint32_t recording_threads)
+    {
+        const auto& queue_segment = segments_[segment];
+        const auto first_position = queue_segment.first_position;
+        const auto pass_count = queue_segment.last_position - queue_segment.first_position;
+        // No point in having more threads than passes, recording pools belong to the graphics queue family
+        const auto max_groups = queue_segment.queue == PassQueue::Graphics ? recording_threads : 1u;
+        const auto group_count = std::clamp<std::size_t>(max_groups, 1, std::max<std::size_t>(pass_count, 1));
+        if (group_count == 1) {
+            record_passes(command_buffer, first_position, queue_segment.last_position);
+        } else {
+            // Record contiguous groups of passes together with the barriers in front of them
+            // into secondary command buffers, one group per thread
+            auto secondary_command_buffers = std::pmr::vector<VkCommandBuffer>(group_count, frame_arena_.get());
+            for (std::size_t group = 0; group < group_count; ++group) {
+                secondary_command_buffers[group] = begin_recording_command_buffer(group);
+            }
+            // Rendering scopes cannot span command buffers, move boundaries inside one to its start
+            const auto group_boundary = [&](std::size_t group) {
+                const auto position = first_position + group * pass_count / group_count;
+                if (position < queue_segment.last_position && position_scopes_[position]) {
+                    return rendering_scopes_[*position_scopes_[position]].first_position;
+                }
+                return position;
+            };
+            auto errors = std::pmr::vector<std::exception_ptr>(group_count, frame_arena_.get());
+            const auto record_group = [&](std::size_t group) {
+                try {
+                    const auto group_first = group_boundary(group);
+                    const auto group_last = group_boundary(group + 1);
+                    record_passes(secondary_command_buffers[group], group_first, group_last);
+                    if (VkResult err = vkEndCommandBuffer(secondary_command_buffers[group])) {
+                        throw std::runtime_error(fmt::format("vkEndCommandBuffer() failed: {}", string_VkResult(err)));
+                    }
+                } catch (...) {
+                    errors[group] = std::current_exception();
+                }
+            };
+            if (!recording_threads_ || recording_threads_->worker_count() + 1 < group_count) {
+                recording_threads_ = std::make_unique<RecordingThreadPool>(group_count - 1);
+            }
+            recording_threads_->run(group_count, record_group);
+            for (const auto& error : errors) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+
+            // Stitch groups into the primary in sorted order
+            vkCmdExecuteCommands(command_buffer, static_cast<std::uint32_t>(secondary_command_buffers.size()), secondary_command_buffers.data());
+        }
+
+        // Trailing batch of the final segment, final layout transitions for imported textures used by the last pass
+        if (segment + 1 == segments_.size()) {
+            execute_barrier_batch(command_buffer, barrier_batches_.back());
+        }
+
+        // Hand resources over to the other queue
+        execute_barrier_batch(command_buffer, queue_segment.release_batch);
+
+        // Unsignal events for the next frame, ordered after every wait recorded above
+        for (const auto& split_barrier : split_barriers_) {
+            if (position_segments_[split_barrier.wait_position] == segment) {
+                vkCmdResetEvent2(command_buffer, split_barrier.event, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+            }
+        }
+    }
+
+    void RenderGraph::record_passes(VkCommandBuffer command_buffer, std::size_t first_position, std::size_t last_position)
+    {
+        // Ranges start outside of rendering scopes, where the queries of the range can be reset
+        const auto timestamp_end = timestamp_position_end(first_position, last_position);
+        if (timestamp_end > first_position) {
+            vkCmdResetQueryPool(command_buffer, timestamp_queries_->query_pool,
+                                static_cast<std::uint32_t>(2 * first_position),
+                                static_cast<std::uint32_t>(2 * (timestamp_end - first_position)));
+        }
+
+        auto context = RenderPassContext{*this, command_buffer};
+        for (std::size_t position = first_position; position < last_position; ++position) {
+            // Timestamps inside multiview rendering write one query per view, those scopes are only timed at their bounds
+            const auto timed_scope = multiview_scope(position);
+            const auto timed_begin = !timed_scope || rendering_scopes_[*timed_scope].first_position == position;
+            const auto timed_end = !timed_scope || rendering_scopes_[*timed_scope].last_position == position + 1;
+
+            // Time spent waiting on the barriers in front of a pass counts towards the pass
+            if (position < timestamp_end && timed_begin) {
+                vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, timestamp_queries_->query_pool, static_cast<std::uint32_t>(2 * position));
+            }
+            // Barriers between merged passes only covered their shared attachments, rasterization order orders those
+            const auto scope = position_scopes_[position];
+            if (!scope || rendering_scopes_[*scope].first_position == position) {
+                execute_barrier_batch(command_buffer, barrier_batches_[position]);
+            }
+            if (scope && rendering_scopes_[*scope].first_position == position) {
+                begin_rendering_scope(command_buffer, rendering_scopes_[*scope]);
+            }
+            context.position_ = position;
+            passes_[sorted_passes_[position]].execute(context);
+            if (scope && rendering_scopes_[*scope].last_position == position + 1) {
+                vkCmdEndRendering(command_buffer);
+            }
+            if (position < timestamp_end && timed_end) {
+                vkCmdWriteTimestamp2(command_buffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, timestamp_queries_->query_pool, static_cast<std::uint32_t>(2 * position + 1));
+            }
+        }
+    }
+
+    VkCommandBuffer RenderGraph::begin_recording_command_buffer(std::size_t thread_idx)
+    {
+        // Command pools are externally synchronized, each thread gets its own
+        if (thread_idx == recording_pools_.size()) {
+            const auto command_pool_info = VkCommandPoolCreateInfo{
+                .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+                .queueFamilyIndex = queue_family_,
+            };
+            VkCommandPool command_pool = VK_NULL_HANDLE;
+            if (VkResult err = vkCreateCommandPool(vk_device_, &command_pool_info, nullptr, &command_pool)) {
+                throw std::runtime_error(fmt::format("vkCreateCommandPool() failed: {}", string_VkResult(err)));
+            } else {
+                ORION_RENDERER_LOG_INFO("Created VkCommandPool {}", fmt::ptr(command_pool));
+            }
+            recording_pools_.push_back({command_pool, VK_NULL_HANDLE});
+
+            const auto cb_allocate_info = VkCommandBufferAllocateInfo{
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                .pNext = nullptr,
+                .commandPool = command_pool,
+                .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+                .commandBufferCount = 1,
+            };
+            if (VkResult err = vkAllocateCommandBuffers(vk_device_, &cb_allocate_info, &recording_pools_.back().command_buffer)) {
+                throw std::runtime_error(fmt::format("vkAllocateCommandBuffers() failed: {}", string_VkResult(err)));
+            }
+        }
+        ORION_ASSERT(thread_idx < recording_pools_.size());
+
+        // The graph belongs to a single frame in flight, its previous submission has completed
+        const auto& recording_pool = recording_pools_[thread_idx];
+        if (VkResult err = vkResetCommandPool(vk_device_, recording_pool.command_pool, {})) {
+            throw std::runtime_error(fmt::format("vkResetCommandPool() failed: {}", string_VkResult(err)));
+        }
+
+        // Passes begin and end their own rendering, secondaries are recorded outside of any render pass instance
+        const auto inheritance_info = VkCommandBufferInheritanceInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+            .pNext = nullptr,
+        };
+        const auto cb_begin_info = VkCommandBufferBeginInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = &inheritance_info,
+        };
+        if (VkResult err = vkBeginCommandBuffer(recording_pool.command_buffer, &cb_begin_info)) {
+            throw std::runtime_error(fmt::format("vkBeginCommandBuffer() failed: {}", string_VkResult(err)));
+        }
+        return recording_pool.command_buffer;
+    }
+
+    VkCommandBuffer RenderGraph::begin_segment_command_buffer(PassQueue queue)
+    {
+        if (segment_pools_.empty()) {
+            segment_pools_.resize(2);
+        }
+        auto& segment_pool = segment_pools_[static_cast<std::size_t>(queue)];
+        if (segment_pool.command_pool == VK_NULL_HANDLE) {
+            const auto command_pool_info = VkCommandPoolCreateInfo{
+                .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+                .queueFamilyIndex = queue_family_index(queue),
+            };
+            if (VkResult err = vkCreateCommandPool(vk_device_, &command_pool_info, nullptr, &segment_pool.command_pool)) {
+                throw std::runtime_error(fmt::format("vkCreateCommandPool() failed: {}", string_VkResult(err)));
+            } else {
+                ORION_RENDERER_LOG_INFO("Created VkCommandPool {}", fmt::ptr(segment_pool.command_pool));
+            }
+        }
+        if (segment_pool.used_command_buffers == segment_pool.command_buffers.size()) {
+            const auto cb_allocate_info = VkCommandBufferAllocateInfo{
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                .pNext = nullptr,
+                .commandPool = segment_pool.command_pool,
+                .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                .commandBufferCount = 1,
+            };
+            VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+            if (VkResult err = vkAllocateCommandBuffers(vk_device_, &cb_allocate_info, &command_buffer)) {
+                throw std::runtime_error(fmt::format("vkAllocateCommandBuffers() failed: {}", string_VkResult(err)));
+            }
+            segment_pool.command_buffers.push_back(command_buffer);
+        }
+
+        const auto cb_begin_info = VkCommandBufferBeginInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr,
+        };
+        VkCommandBuffer command_buffer = segment_pool.command_buffers[segment_pool.used_command_buffers++];
+        if (VkResult err = vkBeginCommandBuffer(command_buffer, &cb_begin_info)) {
+            throw std::runtime_error(fmt::format("vkBeginCommandBuffer() failed: {}", string_VkResult(err)));
+        }
+        return command_buffer;
+    }
+
+    void RenderGraph::begin_rendering_scope(VkCommandBuffer command_buffer, const RenderingScope& scope) const
+    {
+        // Views and clear values can change while the compiled graph is reused
+        const auto to_attachment_info = [this](const ScopeAttachment& attachment) {
+            const auto& clear_values = passes_[sorted_passes_[attachment.clear_position]].clear_values;
+            auto it = std::ranges::find(clear_values, attachment.handle.index, [](const AttachmentClearValue& clear_value) { return clear_value.handle.index; });
+            return VkRenderingAttachmentInfo{
+                .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                .pNext = nullptr,
+                .imageView = get_image_view(attachment.handle),
+                .imageLayout = attachment.layout,
+                .resolveMode = attachment.resolve_mode,
+                .resolveImageView = attachment.resolve_target ? get_image_view(*attachment.resolve_target) : VK_NULL_HANDLE,
+                .resolveImageLayout = attachment.resolve_target ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+                .loadOp = attachment.load_op,
+                .storeOp = attachment.store_op,
+                .clearValue = it != clear_values.end() ? it->value : VkClearValue{},
+            };
+        };
+        ORION_ASSERT(scope.color_attachments.size() <= max_color_attachments);
+        auto color_attachments = std::array<VkRenderingAttachmentInfo, max_color_attachments>{};
+        for (std::size_t slot = 0; slot < scope.color_attachments.size(); ++slot) {
+            color_attachments[slot] = to_attachment_info(scope.color_attachments[slot]);
+        }
+        const auto depth_attachment = scope.depth_attachment ? to_attachment_info(*scope.depth_attachment) : VkRenderingAttachmentInfo{};
+        // The layer count is ignored with multiview
+        const auto& first_pass = passes_[sorted_passes_[scope.first_position]];
+        const auto rendering_info = VkRenderingInfo{
+            .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+            .pNext = nullptr,
+            .flags = {},
+            .renderArea = *first_pass.render_area,
+            .layerCount = 1,
+            .viewMask = first_pass.view_mask,
+            .colorAttachmentCount = static_cast<std::uint32_t>(scope.color_attachments.size()),
+            .pColorAttachments = color_attachments.data(),
+            .pDepthAttachment = scope.depth_attachment ? &depth_attachment : nullptr,
+            .pStencilAttachment = nullptr,
+        };
+        vkCmdBeginRendering(command_buffer, &rendering_info);
+    }
+
+    void RenderGraph::execute_barrier_batch(VkCommandBuffer command_buffer, const BarrierBatch& batch) const
+    {
+        // Signal split barriers produced by the previous pass
+        for (auto split_barrier_idx : batch.signal_split_barriers) {
+            const auto& split_barrier = split_barriers_[split_barrier_idx];
+            const auto dependency_info = to_dependency_info(split_barrier.buffer_barriers, split_barrier.image_barriers);
+            vkCmdSetEvent2(command_buffer, split_barrier.event, &dependency_info);
+        }
+
+        // Wait for split barriers consumed by the next pass
+        if (!batch.wait_events.empty()) {
+            vkCmdWaitEvents2(command_buffer,
+                             static_cast<std::uint32_t>(batch.wait_events.size()),
+                             batch.wait_events.data(),
+                             batch.wait_dependencies.data());
+        }
+
+        if (!batch.buffer_barriers.empty() || !batch.image_barriers.empty()) {
+            const auto dependency_info = to_dependency_info(batch.buffer_barriers, batch.image_barriers);
+            vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        }
+    }
+
+    TransientHeap::TransientHeap(VkDevice device, VmaAllocator allocator, VkSemaphore frame_semaphore, const RenderGraph::TransientPoolDesc& desc)
+        : vk_device_(device)
+        , vma_allocator_(allocator)
+        , frame_semaphore_(frame_semaphore)
+        , desc_(desc)
+    {
+    }
+
+    TransientHeap::~TransientHeap()
+    {
+        for (auto& memory_block : free_memory_blocks_) {
+            destroy_memory_block(memory_block);
+        }
+        for (const auto& buffer : free_buffers_) {
+            destroy_buffer(buffer);
+        }
+        for (auto& [_, ring] : history_rings_) {
+            destroy_history_ring(ring);
+        }
+        for (auto& ring : retired_history_rings_) {
+            destroy_history_ring(ring);
+        }
+    }
+
+    RenderGraph::TransientMemoryBlock TransientHeap::acquire_memory_block(const VkMemoryRequirements& requirements, bool lazily_allocated, std::uint64_t frame_value)
+    {
+        // Smallest reusable block that fits, the most recently released among equal sizes
+        //  Blocks of older frames then stay unused and are evicted.
+        const auto completed_value = get_completed_frame_value();
+        auto best_block = free_memory_blocks_.end();
+        for (auto it = free_memory_blocks_.begin(); it != free_memory_blocks_.end(); ++it) {
+            const auto fits = it->requirements.size >= requirements.size &&
+                              it->requirements.alignment >= requirements.alignment &&
+                              (requirements.memoryTypeBits & (1u << it->memory_type)) != 0;
+            if (!is_reusable(it->release_value, completed_value, frame_value) || it->lazily_allocated != lazily_allocated || !fits) {
+                continue;
+            }
+            if (best_block == free_memory_blocks_.end() || it->requirements.size < best_block->requirements.size ||
+                (it->requirements.size == best_block->requirements.size && it->release_value > best_block->release_value)) {
+                best_block = it;
+            }
+        }
+        if (best_block == free_memory_blocks_.end()) {
+            return allocate_memory_block(requirements, lazily_allocated);
+        }
+        auto memory_block = std::move(*best_block);
+        free_memory_blocks_.erase(best_block);
+        return memory_block;
+    }
+
+    void TransientHeap::release_memory_block(RenderGraph::TransientMemoryBlock block, std::uint64_t frame_value)
+    {
+        block.release_value = frame_value;
+        free_memory_blocks_.push_back(std::move(block));
+    }
+
+    const RenderGraph::TextureAllocation& TransientHeap::get_image(RenderGraph::TransientMemoryBlock& block, const RenderGraph::TextureDesc& desc)
+    {
+        // Check if image was cached
+        auto it = block.images.find(desc);
+        if (it != block.images.end()) {
+            return it->second;
+        }
+
+        // Place image into the block's memory
+        const auto image_info = to_image_create_info(desc);
+        VkImage image = VK_NULL_HANDLE;
+        if (VkResult err = vmaCreateAliasingImage(vma_allocator_, block.allocation, &image_info, &image)) {
+            throw std::runtime_error(fmt::format("vmaCreateAliasingImage() failed: {}", string_VkResult(err)));
+        } else {
+            ORION_RENDERER_LOG_INFO("Created VkImage {} in transient memory block {}", fmt::ptr(image), fmt::ptr(block.allocation));
+        }
+
+        // Create image view of the whole image
+        const auto whole_range = VkImageSubresourceRange{
+            .aspectMask = to_image_aspect_flags(desc.format),
+            .baseMipLevel = 0,
+            .levelCount = desc.mip_levels,
+            .baseArrayLayer = 0,
+            .layerCount = desc.array_layers,
+        };
+        VkImageView view = VK_NULL_HANDLE;
+        try {
+            view = create_image_view(image, desc, whole_range);
+        } catch (...) {
+            vkDestroyImage(vk_device_, image, nullptr);
+            throw;
+        }
+
+        return block.images.emplace(desc, RenderGraph::TextureAllocation{image, view, {}}).first->second;
+    }
+
+    VkImageView TransientHeap::get_image_view(RenderGraph::TransientMemoryBlock& block, const RenderGraph::TextureDesc& desc, const VkImageSubresourceRange& range)
+    {
+        // Views of parts of the image are cached with it
+        auto& image = block.images.at(desc);
+        auto it = std::ranges::find_if(image.subresource_views, [&](const RenderGraph::SubresourceView& view) { return ranges_equal(view.range, range); });
+        if (it != image.subresource_views.end()) {
+            return it->view;
+        }
+        image.subresource_views.push_back({range, create_image_view(image.image, desc, range)});
+        return image.subresource_views.back().view;
+    }
+
+    VkImageView TransientHeap::create_image_view(VkImage image, const RenderGraph::TextureDesc& desc, const VkImageSubresourceRange& range)
+    {
+        const auto image_view_info = VkImageViewCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = {},
+            .image = image,
+            .viewType = range.layerCount > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D,
+            .format = desc.format,
+            .components = {}, // VK_COMPONENT_SWIZZLE_IDENTITY
+            .subresourceRange = range,
+        };
+        VkImageView view = VK_NULL_HANDLE;
+        if (VkResult err = vkCreateImageView(vk_device_, &image_view_info, nullptr, &view)) {
+            throw std::runtime_error(fmt::format("vkCreateImageView() failed: {}", string_VkResult(err)));
+        } else {
+            ORION_RENDERER_LOG_INFO("Created VkImageView {}", fmt::ptr(view));
+        }
+        return view;
+    }
+
+    RenderGraph::HistoryRing& TransientHeap::get_history_ring(std::string_view name, const RenderGraph::TextureDesc& desc, std::uint32_t history_length, std::uint64_t frame_value)
+    {
+        auto it = history_rings_.find(name);
+        if (it == history_rings_.end()) {
+            it = history_rings_.emplace(name, RenderGraph::HistoryRing{}).first;
+        }
+        auto& ring = it->second;
+
+        // A resized history has nothing worth keeping, frames still in flight may be using the old images
+        const auto same_desc = !(ring.desc < desc) && !(desc < ring.desc);
+        if (!same_desc || ring.images.size() != history_length) {
+            if (!ring.images.empty()) {
+                retired_history_rings_.push_back(std::move(ring));
+            }
+            ring = RenderGraph::HistoryRing{.desc = desc};
+            ring.images.reserve(history_length);
+            for (std::uint32_t i = 0; i < history_length; ++i) {
+                ring.images.push_back(create_history_image(desc));
+            }
+        }
+
+        // First use by this frame moves on to the next image
+        if (ring.frame_value != frame_value) {
+            ORION_ASSERT(frame_value > ring.frame_value);
+            ring.current_image = (ring.current_image + 1) % ring.images.size();
+            ring.frame_value = frame_value;
+        }
+        return ring;
+    }
+
+    VkImageView TransientHeap::get_image_view(RenderGraph::HistoryImage& image, const RenderGraph::TextureDesc& desc, const VkImageSubresourceRange& range)
+    {
+        auto it = std::ranges::find_if(image.texture.subresource_views, [&](const RenderGraph::SubresourceView& view) { return ranges_equal(view.range, range); });
+        if (it != image.texture.subresource_views.end()) {
+            return it->view;
+        }
+        image.texture.subresource_views.push_back({range, create_image_view(image.texture.image, desc, range)});
+        return image.texture.subresource_views.back().view;
+    }
+
+    RenderGraph::BufferAllocation TransientHeap::acquire_buffer(const RenderGraph::BufferDesc& desc, std::uint64_t frame_value)
+    {
+        // Most recently released, buffers of older frames then stay unused and are evicted
+        const auto completed_value = get_completed_frame_value();
+        auto best_buffer = free_buffers_.end();
+        for (auto it = free_buffers_.begin(); it != free_buffers_.end(); ++it) {
+            if (is_reusable(it->release_value, completed_value, frame_value) && it->desc.size == desc.size && it->desc.usage == desc.usage &&
+                (best_buffer == free_buffers_.end() || it->release_value > best_buffer->release_value)) {
+                best_buffer = it;
+            }
+        }
+        if (best_buffer == free_buffers_.end()) {
+            return create_buffer(desc);
+        }
+        auto buffer = *best_buffer;
+        free_buffers_.erase(best_buffer);
+        return buffer;
+    }
+
+    void TransientHeap::release_buffer(RenderGraph::BufferAllocation buffer, std::uint64_t frame_value)
+    {
+        buffer.release_value = frame_value;
+        free_buffers_.push_back(buffer);
+    }
+
+    void TransientHeap::evict()
+    {
+        // Free allocations that have not been used for longer than the heap keeps them
+        const auto completed_value = get_completed_frame_value();
+        const auto expired = [&](std::uint64_t release_value) {
+            return release_value <= completed_value && completed_value - release_value > desc_.max_unused_frames;
+        };
+        std::erase_if(free_memory_blocks_, [&](RenderGraph::TransientMemoryBlock& memory_block) {
+            if (!expired(memory_block.release_value)) {
+                return false;
+            }
+            destroy_memory_block(memory_block);
+            return true;
+        });
+        std::erase_if(free_buffers_, [&](const RenderGraph::BufferAllocation& buffer) {
+            if (!expired(buffer.release_value)) {
+                return false;
+            }
+            destroy_buffer(buffer);
+            return true;
+        });
+        std::erase_if(history_rings_, [&](const auto& named_ring) {
+            if (!expired(named_ring.second.frame_value)) {
+                return false;
+            }
+            destroy_history_ring(named_ring.second);
+            return true;
+        });
+        std::erase_if(retired_history_rings_, [&](const RenderGraph::HistoryRing& ring) {
+            if (ring.frame_value > completed_value) {
+                return false;
+            }
+            destroy_history_ring(ring);
+            return true;
+        });
+
+        // Keep the memory the GPU is done with within budget, least recently used are freed first
+        VkDeviceSize unused_bytes = 0;
+        for (const auto& memory_block : free_memory_blocks_) {
+            unused_bytes += memory_block.release_value <= completed_value ? memory_block.requirements.size : 0;
+        }
+        for (const auto& buffer : free_buffers_) {
+            unused_bytes += buffer.release_value <= completed_value ? buffer.desc.size : 0;
+        }
+        while (unused_bytes > desc_.max_unused_bytes) {
+            auto oldest_block = std::ranges::min_element(free_memory_blocks_, {}, &RenderGraph::TransientMemoryBlock::release_value);
+            auto oldest_buffer = std::ranges::min_element(free_buffers_, {}, &RenderGraph::BufferAllocation::release_value);
+            if (oldest_buffer == free_buffers_.end() ||
+                (oldest_block != free_memory_blocks_.end() && oldest_block->release_value <= oldest_buffer->release_value)) {
+                unused_bytes -= oldest_block->requirements.size;
+                destroy_memory_block(*oldest_block);
+                free_memory_blocks_.erase(oldest_block);
+            } else {
+                unused_bytes -= oldest_buffer->desc.size;
+                destroy_buffer(*oldest_buffer);
+                free_buffers_.erase(oldest_buffer);
+            }
+        }
+    }
+
+    std::uint64_t TransientHeap::get_completed_frame_value() const
+    {
+        std::uint64_t value = 0;
+        if (VkResult err = vkGetSemaphoreCounterValue(vk_device_, frame_semaphore_, &value)) {
+            throw std::runtime_error(fmt::format("vkGetSemaphoreCounterValue() failed: {}", string_VkResult(err)));
+        }
+        return value;
+    }
+
+    bool TransientHeap::is_reusable(std::uint64_t release_value, std::uint64_t completed_value, std::uint64_t frame_value) const
+    {
+        // Earlier frames have been submitted, waiting for them orders their accesses before the new frame's
+        //  A frame never waits for itself, what it released was not submitted.
+        return release_value <= completed_value || (desc_.share_in_flight_memory && release_value < frame_value);
+    }
+
+    RenderGraph::TransientMemoryBlock TransientHeap::allocate_memory_block(const VkMemoryRequirements& requirements, bool lazily_allocated)
+    {
+        // Tile based GPUs back lazily allocated memory on demand, other GPUs have no such memory type
+        const auto lazy_flags = lazily_allocated ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VkMemoryPropertyFlags{};
+        const auto allocation_info = VmaAllocationCreateInfo{
+            .usage = VMA_MEMORY_USAGE_UNKNOWN,
+            .preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | lazy_flags,
+        };
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VmaAllocationInfo allocation_result = {};
+        if (VkResult err = vmaAllocateMemory(vma_allocator_, &requirements, &allocation_info, &allocation, &allocation_result)) {
+            throw std::runtime_error(fmt::format("vmaAllocateMemory() failed: {}", string_VkResult(err)));
+        } else {
+            ORION_RENDERER_LOG_INFO("Allocated VmaAllocation {} ({} bytes) for transient memory block", fmt::ptr(allocation), requirements.size);
+        }
+        return {
+            .allocation = allocation,
+            .requirements = requirements,
+            .memory_type = allocation_result.memoryType,
+            .lazily_allocated = lazily_allocated,
+        };
+    }
+
+    void TransientHeap::destroy_memory_block(RenderGraph::TransientMemoryBlock& block)
+    {
+        // Destroy all images placed in this block first
+        for (const auto& [_, image] : block.images) {
+            for (const auto& subresource_view : image.subresource_views) {
+                vkDestroyImageView(vk_device_, subresource_view.view, nullptr);
+                ORION_RENDERER_LOG_INFO("Destroyed VkImageView {}", fmt::ptr(subresource_view.view));
+            }
+            vkDestroyImageView(vk_device_, image.view, nullptr);
+            ORION_RENDERER_LOG_INFO("Destroyed VkImageView {}", fmt::ptr(image.view));
+            vkDestroyImage(vk_device_, image.image, nullptr);
+            ORION_RENDERER_LOG_INFO("Destroyed VkImage {}", fmt::ptr(image.image));
+        }
+        block.images.clear();
+
+        vmaFreeMemory(vma_allocator_, block.allocation);
+        ORION_RENDERER_LOG_INFO("Freed VmaAllocation {}", fmt::ptr(block.allocation));
+        block.allocation = VK_NULL_HANDLE;
+    }
+
+    RenderGraph::HistoryImage TransientHeap::create_history_image(const RenderGraph::TextureDesc& desc)
+    {
+        // Kept for many frames, allocated on its own rather than in aliased transient memory
+        const auto image_info = to_image_create_info(desc);
+        const auto allocation_info = VmaAllocationCreateInfo{
+            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+        };
+        auto image = RenderGraph::HistoryImage{};
+        if (VkResult err = vmaCreateImage(vma_allocator_, &image_info, &allocation_info, &image.texture.image, &image.allocation, nullptr)) {
+            throw std::runtime_error(fmt::format("vmaCreateImage() failed: {}", string_VkResult(err)));
+        } else {
+            ORION_RENDERER_LOG_INFO("Created VkImage {} for history texture", fmt::ptr(image.texture.image));
+        }
+
+        const auto whole_range = VkImageSubresourceRange{
+            .aspectMask = to_image_aspect_flags(desc.format),
+            .baseMipLevel = 0,
+            .levelCount = desc.mip_levels,
+            .baseArrayLayer = 0,
+            .layerCount = desc.array_layers,
+        };
+        try {
+            image.texture.view = create_image_view(image.texture.image, desc, whole_range);
+        } catch (...) {
+            vmaDestroyImage(vma_allocator_, image.texture.image, image.allocation);
+            throw;
+        }
+        image.subresource_states.resize(static_cast<std::size_t>(desc.mip_levels) * desc.array_layers);
+        return image;
+    }
+
+    void TransientHeap::destroy_history_ring(const RenderGraph::HistoryRing& ring)
+    {
+        for (const auto& image : ring.images) {
+            for (const auto& subresource_view : image.texture.subresource_views) {
+                vkDestroyImageView(vk_device_, subresource_view.view, nullptr);
+                ORION_RENDERER_LOG_INFO("Destroyed VkImageView {}", fmt::ptr(subresource_view.view));
+            }
+            vkDestroyImageView(vk_device_, image.texture.view, nullptr);
+            ORION_RENDERER_LOG_INFO("Destroyed VkImageView {}", fmt::ptr(image.texture.view));
+            vmaDestroyImage(vma_allocator_, image.texture.image, image.allocation);
+            ORION_RENDERER_LOG_INFO("Destroyed VkImage {}", fmt::ptr(image.texture.image));
+        }
+    }
+
+    RenderGraph::BufferAllocation TransientHeap::create_buffer(const RenderGraph::BufferDesc& desc)
+    {
+        const auto buffer_info = VkBufferCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .size = desc.size,
+            .usage = desc.usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+        };
+        const auto allocation_info = VmaAllocationCreateInfo{
+            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+        };
+        auto buffer = RenderGraph::BufferAllocation{.desc = desc};
+        if (VkResult err = vmaCreateBuffer(vma_allocator_, &buffer_info, &allocation_info, &buffer.buffer, &buffer.allocation, nullptr)) {
+            throw std::runtime_error(fmt::format("vmaCreateBuffer() failed: {}", string_VkResult(err)));
+        } else {
+            ORION_RENDERER_LOG_INFO("Created VkBuffer {}", fmt::ptr(buffer.buffer));
+        }
+        return buffer;
+    }
+
+    void TransientHeap::destroy_buffer(const RenderGraph::BufferAllocation& buffer)
+    {
+        vmaDestroyBuffer(vma_allocator_, buffer.buffer, buffer.allocation);
+        ORION_RENDERER_LOG_INFO("Destroyed VkBuffer {}", fmt::ptr(buffer.buffer));
+    }
 } // namespace orion
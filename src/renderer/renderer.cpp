@@ -14,23 +14,45 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <fstream>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 namespace orion
 {
     static constexpr auto frames_in_flight = 2;
+    static constexpr auto render_graph_recording_threads = 2u;
+    static constexpr auto pipeline_compile_threads = 2u;
+    static constexpr auto depth_format = VK_FORMAT_D32_SFLOAT;
+    // Begin and end timestamp of each pass, later passes are not timed
+    static constexpr auto max_timed_passes = 64u;
+    // Frames averaged into the GPU pass timings
+    static constexpr std::size_t gpu_timing_window = 64;
+    // Driver pipeline cache persisted across runs, in the working directory
+    static constexpr auto pipeline_cache_file = "pipeline_cache.bin";
+    // Frames between saves of the pipeline cache, saves are skipped while it did not grow
+    static constexpr std::uint64_t pipeline_cache_save_interval = 3600;
 
     struct PerFrameData {
-        VulkanCommandPool command_pool;
-
         VulkanSemaphore image_available_semaphore;
         VulkanSemaphore render_complete_semaphore;
+        VulkanSemaphore render_graph_semaphore;
+        VulkanQueryPool timestamp_query_pool;
 
         RenderGraph render_graph;
     };
 
+    // Last gpu_timing_window samples of a pass
+    struct GpuTimingHistory {
+        std::array<double, gpu_timing_window> milliseconds = {};
+        std::size_t sample_count = 0;
+        std::size_t next_sample = 0;
+    };
+
     struct Renderer::Impl {
         VulkanInstance vulkan_instance;
         VulkanDevice vulkan_device;
@@ -45,6 +67,13 @@ namespace orion
         VkResult swapchain_status = VK_SUCCESS;
 
         PipelineCache pipeline_cache;
+        PipelineId triangle_pipeline;
+
+        // Indexed alike, in the order passes were first seen
+        std::vector<GpuPassTiming> gpu_pass_timings;
+        std::vector<GpuTimingHistory> gpu_timing_histories;
+
+        bool render_graph_dump_requested = false;
 
         Impl(
             VulkanInstance _instance,
@@ -54,7 +83,8 @@ namespace orion
             std::array<PerFrameData, frames_in_flight> _frame_data,
             VulkanSemaphore _frame_semaphore,
             ImGuiContextWrapper _imgui_context,
-            PipelineCache _pipeline_cache)
+            PipelineCache _pipeline_cache,
+            PipelineId _triangle_pipeline)
             : vulkan_instance(std::move(_instance))
             , vulkan_device(std::move(_device))
             , vulkan_surface(std::move(_surface))
@@ -63,10 +93,15 @@ namespace orion
             , frame_semaphore(std::move(_frame_semaphore))
             , imgui_context(std::move(_imgui_context))
             , pipeline_cache(std::move(_pipeline_cache))
+            , triangle_pipeline(_triangle_pipeline)
         {
         }
 
-        ~Impl() { (void)vulkan_device.wait_idle(); }
+        ~Impl()
+        {
+            (void)vulkan_device.wait_idle();
+            (void)pipeline_cache.save();
+        }
 
         void new_frame()
         {
@@ -84,11 +119,10 @@ namespace orion
                 throw std::runtime_error("vkWaitSemaphores() failed");
             }
 
-            // Reset command buffers
+            // Fast linked pipelines replaced by their optimized version may still be used by frames in flight
+            pipeline_cache.destroy_retired(frame_count + 1, wait_value);
+
             auto& fd = frame_data[frame_count % frames_in_flight];
-            if (!fd.command_pool.reset()) {
-                throw std::runtime_error("vkResetCommandPool() failed");
-            }
 
             // Acquire swapchain image
             const auto image_index = vulkan_swapchain.acquire_next_image(fd.image_available_semaphore, UINT64_MAX);
@@ -103,15 +137,9 @@ namespace orion
                 }
             }
 
-            // Render frame
-            //  Begin command buffer recording
-            auto command_buffer = fd.command_pool.begin_command_buffer();
-            if (!command_buffer) {
-                throw std::runtime_error("vkBeginCommandBuffer failed");
-            }
-
-            // Reset render graph
-            fd.render_graph.reset();
+            // Reset render graph, which reads back the pass timings of its previous frame
+            fd.render_graph.reset(frame_count + 1);
+            update_gpu_pass_timings(fd.render_graph.get_pass_timings());
 
             // Import swapchain image to render graph
             auto swapchain_texture = fd.render_graph.import_texture({
@@ -120,12 +148,17 @@ namespace orion
                 .current_layout = VK_IMAGE_LAYOUT_UNDEFINED,
                 .final_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
                 .format = vulkan_swapchain.image_format,
+                .extent = {
+                    .width = vulkan_swapchain.image_extent.width,
+                    .height = vulkan_swapchain.image_extent.height,
+                    .depth = 1u,
+                },
             });
 
             // Create transient depth attachment
-            const auto depth_texture = fd.render_graph.create_transient_texture({
+            auto depth_texture = fd.render_graph.create_transient_texture({
                 .image_type = VK_IMAGE_TYPE_2D,
-                .format = VK_FORMAT_D32_SFLOAT,
+                .format = depth_format,
                 .extent = {
                     .width = vulkan_swapchain.image_extent.width,
                     .height = vulkan_swapchain.image_extent.height,
@@ -137,38 +170,17 @@ namespace orion
             // Define color pass
             fd.render_graph.add_pass("Color", [&](RenderPassBuilder& builder) {
                 swapchain_texture = builder.write_texture(swapchain_texture, TextureUsage::ColorAttachment);
-                builder.write_texture(depth_texture, TextureUsage::DepthAttachment);
+                depth_texture = builder.write_texture(depth_texture, TextureUsage::DepthAttachment);
+                builder.set_rendering({.extent = vulkan_swapchain.image_extent});
+                builder.set_clear_value(swapchain_texture, {.color = {{1.0f, 0.0f, 1.0f, 1.0f}}});
+                builder.set_clear_value(depth_texture, {.depthStencil = {.depth = 1.0f}});
                 return [=, this](RenderPassContext& ctx) {
-                    const auto clear_color = VkClearColorValue{{1.0f, 0.0f, 1.0f, 1.0f}};
-                    const auto color_attachment = VkRenderingAttachmentInfo{
-                        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-                        .imageView = ctx.get_image_view(swapchain_texture),
-                        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-                        .clearValue = {.color = clear_color},
-                    };
-                    const auto clear_depth = VkClearDepthStencilValue{.depth = 1.0f};
-                    const auto depth_attachment = VkRenderingAttachmentInfo{
-                        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-                        .imageView = ctx.get_image_view(depth_texture),
-                        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-                        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-                        .clearValue = {.depthStencil = clear_depth},
-                    };
-                    const auto rendering_info = VkRenderingInfo{
-                        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
-                        .renderArea = {.extent = vulkan_swapchain.image_extent},
-                        .layerCount = 1,
-                        .colorAttachmentCount = 1,
-                        .pColorAttachments = &color_attachment,
-                        .pDepthAttachment = &depth_attachment,
-                    };
-                    vkCmdBeginRendering(ctx.cmd(), &rendering_info);
-
-                    // Get the pipeline from the cache and bind it
-                    vkCmdBindPipeline(ctx.cmd(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_cache.get("triangle"));
+                    // Get the pipeline from the cache and bind it, skip drawing while it is being compiled
+                    VkPipeline pipeline = pipeline_cache.get(triangle_pipeline);
+                    if (pipeline == VK_NULL_HANDLE) {
+                        return;
+                    }
+                    vkCmdBindPipeline(ctx.cmd(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
                     // Set the viewpprt
                     const auto viewport = VkViewport{
@@ -189,60 +201,36 @@ namespace orion
 
                     // Draw our triangle
                     vkCmdDraw(ctx.cmd(), 3, 1, 0, 0);
-
-                    vkCmdEndRendering(ctx.cmd());
                 };
             });
 
-            // Define imgui pass
+            // Define imgui pass, usually merged into the rendering scope of the color pass
+            //  Declares the depth attachment its pipeline is created with, its scope has it even when not merged.
             fd.render_graph.add_pass("ImGui", [&](RenderPassBuilder& builder) {
                 swapchain_texture = builder.write_texture(swapchain_texture, TextureUsage::ColorAttachment);
-                return [=, this](RenderPassContext& ctx) {
-                    const auto color_attachment = VkRenderingAttachmentInfo{
-                        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-                        .imageView = ctx.get_image_view(swapchain_texture),
-                        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
-                        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-                    };
-                    const auto rendering_info = VkRenderingInfo{
-                        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
-                        .renderArea = {.extent = vulkan_swapchain.image_extent},
-                        .layerCount = 1,
-                        .colorAttachmentCount = 1,
-                        .pColorAttachments = &color_attachment,
-                    };
-                    vkCmdBeginRendering(ctx.cmd(), &rendering_info);
+                depth_texture = builder.write_texture(depth_texture, TextureUsage::DepthAttachment);
+                builder.set_rendering({.extent = vulkan_swapchain.image_extent});
+                return [](RenderPassContext& ctx) {
                     ImGui::Render();
                     ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), ctx.cmd());
-                    vkCmdEndRendering(ctx.cmd());
                 };
             });
 
-            // Compile & execute render graph
+            // Compile render graph and submit it to the graphics and async compute queues
             fd.render_graph.compile();
-            fd.render_graph.execute(*command_buffer);
-
-            //  End command buffer recording
-            if (VkResult err = vkEndCommandBuffer(*command_buffer)) {
-                ORION_RENDERER_LOG_ERROR("vkEndCommandBuffer() failed: {}", string_VkResult(err));
-                throw std::runtime_error("vkEndCommandBuffer failed");
+            if (render_graph_dump_requested || ImGui::IsKeyPressed(ImGuiKey_F12, false)) {
+                render_graph_dump_requested = false;
+                dump_render_graph(fd.render_graph);
             }
-
-            // Submit command buffer to queue
-            const auto wait_semaphores = VkSemaphoreSubmitInfo{
-                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-                .pNext = nullptr,
-                .semaphore = fd.image_available_semaphore.vk_semaphore,
-                .value = 0, // ignored, binary semaphore
-                .stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-                .deviceIndex = 0,
-            };
-            const auto cb_submit_info = VkCommandBufferSubmitInfo{
-                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
-                .pNext = nullptr,
-                .commandBuffer = *command_buffer,
-                .deviceMask = 0,
+            const auto wait_semaphores = std::array{
+                VkSemaphoreSubmitInfo{
+                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                    .pNext = nullptr,
+                    .semaphore = fd.image_available_semaphore.vk_semaphore,
+                    .value = 0, // ignored, binary semaphore
+                    .stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    .deviceIndex = 0,
+                },
             };
             const auto signal_semaphores = std::array{
                 VkSemaphoreSubmitInfo{
@@ -262,20 +250,18 @@ namespace orion
                     .deviceIndex = 0,
                 },
             };
-            const auto submit_info = VkSubmitInfo2{
-                .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
-                .pNext = nullptr,
-                .flags = {},
-                .waitSemaphoreInfoCount = 1,
-                .pWaitSemaphoreInfos = &wait_semaphores,
-                .commandBufferInfoCount = 1,
-                .pCommandBufferInfos = &cb_submit_info,
-                .signalSemaphoreInfoCount = 2,
-                .pSignalSemaphoreInfos = signal_semaphores.data(),
-            };
-            if (VkResult err = vkQueueSubmit2(vulkan_device.graphics_queue, 1, &submit_info, VK_NULL_HANDLE)) {
-                ORION_RENDERER_LOG_ERROR("vkQueueSubmit2() failed: {}", string_VkResult(err));
-                throw std::runtime_error("vkQueueSubmit2 failed");
+            fd.render_graph.submit({
+                .queue = vulkan_device.graphics_queue,
+                .async_compute_queue = vulkan_device.compute_queue,
+                .wait_semaphores = wait_semaphores,
+                .signal_semaphores = signal_semaphores,
+                .timeline_semaphore = fd.render_graph_semaphore.vk_semaphore,
+                .recording_threads = render_graph_recording_threads,
+            });
+
+            // Pipelines created since the last save survive a crash
+            if (frame_count % pipeline_cache_save_interval == 0) {
+                (void)pipeline_cache.save();
             }
 
             // Present swapchain image
@@ -301,6 +287,45 @@ namespace orion
             }
         }
 
+        void update_gpu_pass_timings(std::span<const RenderGraph::PassTiming> pass_timings)
+        {
+            for (const auto& pass_timing : pass_timings) {
+                auto it = std::ranges::find(gpu_pass_timings, pass_timing.name, &GpuPassTiming::name);
+                if (it == gpu_pass_timings.end()) {
+                    gpu_pass_timings.push_back({std::string{pass_timing.name}, 0.0, 0.0});
+                    gpu_timing_histories.emplace_back();
+                    it = gpu_pass_timings.end() - 1;
+                }
+                auto& history = gpu_timing_histories[static_cast<std::size_t>(it - gpu_pass_timings.begin())];
+                history.milliseconds[history.next_sample] = pass_timing.milliseconds;
+                history.next_sample = (history.next_sample + 1) % gpu_timing_window;
+                history.sample_count = std::min(history.sample_count + 1, gpu_timing_window);
+
+                const auto samples = std::span{history.milliseconds}.first(history.sample_count);
+                double sum = 0.0;
+                for (double sample : samples) {
+                    sum += sample;
+                }
+                it->average_milliseconds = sum / static_cast<double>(samples.size());
+                it->max_milliseconds = std::ranges::max(samples);
+            }
+        }
+
+        static void dump_render_graph(const RenderGraph& render_graph)
+        {
+            // Failing to write a dump is not worth stopping rendering for
+            const auto write_file = [](const char* path, const std::string& contents) {
+                auto file = std::ofstream{path, std::ios::binary | std::ios::trunc};
+                if (!file.write(contents.data(), static_cast<std::streamsize>(contents.size()))) {
+                    ORION_RENDERER_LOG_ERROR("Failed to write render graph dump {}", path);
+                } else {
+                    ORION_RENDERER_LOG_INFO("Wrote render graph dump {}", path);
+                }
+            };
+            write_file("render_graph.dot", render_graph.to_dot());
+            write_file("render_graph.json", render_graph.to_json());
+        }
+
         [[nodiscard]] bool swapchain_out_of_date() const noexcept
         {
             return swapchain_status == VK_SUBOPTIMAL_KHR || swapchain_status == VK_ERROR_OUT_OF_DATE_KHR;
@@ -384,15 +409,28 @@ namespace orion
             return tl::unexpected("Failed to create Vulkan swapchain");
         }
 
+        // Create frame counter semaphore
+        auto frame_semaphore = vulkan_device->create_timeline_semaphore(0);
+        if (!frame_semaphore) {
+            return tl::unexpected("Failed to create Vulkan semaphore");
+        }
+
+        // Create transient resource heap shared by the render graphs of all frames
+        auto transient_heap = std::make_shared<TransientHeap>(vulkan_device->vk_device, vulkan_device->vma_allocator, frame_semaphore->vk_semaphore);
+
+        // Time render graph passes on queues able to write timestamps
+        VkPhysicalDeviceProperties physical_device_properties;
+        vkGetPhysicalDeviceProperties(physical_device, &physical_device_properties);
+        std::uint32_t queue_family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, queue_families.data());
+        const auto graphics_timestamps = queue_families[vulkan_device->graphics_queue_family].timestampValidBits != 0;
+        const auto async_compute_timestamps = queue_families[vulkan_device->compute_queue_family].timestampValidBits != 0;
+
         // Create per frame resources
         std::array<PerFrameData, frames_in_flight> frame_data;
         for (std::uint32_t i = 0; i < frames_in_flight; ++i) {
-            auto command_pool = vulkan_device->create_command_pool({vulkan_device->graphics_queue_family, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT});
-            if (!command_pool) {
-                return tl::unexpected("Failed to create Vulkan command pool");
-            }
-            frame_data[i].command_pool = std::move(*command_pool);
-
             auto image_available_semaphore = vulkan_device->create_binary_semaphore();
             if (!image_available_semaphore) {
                 return tl::unexpected("Failed to create Vulkan semaphpre");
@@ -403,41 +441,64 @@ namespace orion
                 return tl::unexpected("Failed to create Vulkan semaphpre");
             }
             frame_data[i].render_complete_semaphore = std::move(*render_complete_semaphore);
+            auto render_graph_semaphore = vulkan_device->create_timeline_semaphore(0);
+            if (!render_graph_semaphore) {
+                return tl::unexpected("Failed to create Vulkan semaphore");
+            }
+            frame_data[i].render_graph_semaphore = std::move(*render_graph_semaphore);
 
-            frame_data[i].render_graph = RenderGraph{vulkan_device->vk_device, vulkan_device->vma_allocator};
-        }
+            frame_data[i].render_graph = RenderGraph{vulkan_device->vk_device, vulkan_device->vma_allocator, transient_heap, vulkan_device->graphics_queue_family, vulkan_device->compute_queue_family};
 
-        // Create frame counter semaphore
-        auto frame_semaphore = vulkan_device->create_timeline_semaphore(0);
-        if (!frame_semaphore) {
-            return tl::unexpected("Failed to create Vulkan semaphore");
+            if (graphics_timestamps) {
+                auto timestamp_query_pool = vulkan_device->create_timestamp_query_pool(2 * max_timed_passes);
+                if (!timestamp_query_pool) {
+                    return tl::unexpected("Failed to create Vulkan query pool");
+                }
+                frame_data[i].timestamp_query_pool = std::move(*timestamp_query_pool);
+                frame_data[i].render_graph.set_timestamp_queries({
+                    .query_pool = frame_data[i].timestamp_query_pool.vk_query_pool,
+                    .query_count = frame_data[i].timestamp_query_pool.query_count,
+                    .timestamp_period = physical_device_properties.limits.timestampPeriod,
+                    .graphics_timestamps = graphics_timestamps,
+                    .async_compute_timestamps = async_compute_timestamps,
+                });
+            }
         }
 
+
         // Initialize imgui
         auto imgui_context = ImGuiContextWrapper::create({
             desc.window,
             *vulkan_device,
             *vulkan_swapchain,
+            depth_format,
         });
         if (!imgui_context) {
             return tl::unexpected(std::move(imgui_context.error()));
         }
 
         // Create pipeline cache
-        auto pipeline_cache = PipelineCache::initialize(vulkan_device->vk_device);
+        auto pipeline_cache = PipelineCache::initialize({
+            .device = vulkan_device->vk_device,
+            .device_properties = physical_device_properties,
+            .cache_file = pipeline_cache_file,
+            .compile_threads = pipeline_compile_threads,
+            .shader_module_identifiers = vulkan_device->features.shader_module_identifier,
+            .graphics_pipeline_library = vulkan_device->features.graphics_pipeline_library,
+        });
         if (!pipeline_cache) {
             return tl::unexpected("Failed to create pipeline cache");
         }
 
-        // Create basic triangle pipeline
-        (void)pipeline_cache->build("triangle", [&](PipelineBuilder& builder) {
+        // Create basic triangle pipeline in the background
+        const auto triangle_pipeline = pipeline_cache->build_async("triangle", [&](PipelineBuilder& builder) {
             builder.set_vertex_shader("shaders/triangle.vert.spv");
             builder.set_fragment_shader("shaders/triangle.frag.spv");
             builder.set_viewport_count(1);
             builder.set_scissor_count(1);
             builder.set_cull_mode(VK_CULL_MODE_NONE);
             builder.add_color_attachment(vulkan_swapchain->image_format);
-            builder.set_depth_attachment(VK_FORMAT_D32_SFLOAT);
+            builder.set_depth_attachment(depth_format);
         });
 
         return Renderer{std::make_unique<Impl>(
@@ -448,7 +509,8 @@ namespace orion
             std::move(frame_data),
             std::move(*frame_semaphore),
             std::move(*imgui_context),
-            std::move(*pipeline_cache))};
+            std::move(*pipeline_cache),
+            triangle_pipeline)};
     }
 
     Renderer::Renderer(std::unique_ptr<Impl> impl)
@@ -479,4 +541,14 @@ namespace orion
     {
         return impl_->recreate_swapchain(width, height);
     }
+
+    std::span<const GpuPassTiming> Renderer::gpu_pass_timings() const noexcept
+    {
+        return impl_->gpu_pass_timings;
+    }
+
+    void Renderer::dump_render_graph() noexcept
+    {
+        impl_->render_graph_dump_requested = true;
+    }
 } // namespace orion
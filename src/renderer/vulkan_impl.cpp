@@ -22,6 +22,7 @@
 #include <GLFW/glfw3.h>
 
 #include <algorithm>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -236,16 +237,43 @@ namespace orion
             ORION_RENDERER_LOG_DEBUG("Using queue family {} for graphics & presentation", graphics_queue_family_index);
         }
 
-        // Create a single graphics/presentation queue
+        // Find a dedicated compute queue family for async compute
+        //  Fall back to the graphics queue if the device has none
+        std::uint32_t compute_queue_family_index = graphics_queue_family_index;
+        for (std::uint32_t i = 0; i < queue_family_count; ++i) {
+            const auto queue_flags = queue_families[i].queueFamilyProperties.queueFlags;
+            if (queue_flags & VK_QUEUE_COMPUTE_BIT && !(queue_flags & VK_QUEUE_GRAPHICS_BIT)) {
+                compute_queue_family_index = i;
+                break;
+            }
+        }
+        if (compute_queue_family_index == graphics_queue_family_index) {
+            ORION_RENDERER_LOG_DEBUG("No dedicated compute queue family, async compute runs on the graphics queue");
+        } else {
+            ORION_RENDERER_LOG_DEBUG("Using queue family {} for async compute", compute_queue_family_index);
+        }
+
+        // Create a graphics/presentation queue and a compute queue if available
         const auto queue_priority = 1.0f;
-        const auto queue_info = VkDeviceQueueCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = {},
-            .queueFamilyIndex = graphics_queue_family_index,
-            .queueCount = 1,
-            .pQueuePriorities = &queue_priority,
+        const auto queue_infos = std::array{
+            VkDeviceQueueCreateInfo{
+                .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = {},
+                .queueFamilyIndex = graphics_queue_family_index,
+                .queueCount = 1,
+                .pQueuePriorities = &queue_priority,
+            },
+            VkDeviceQueueCreateInfo{
+                .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = {},
+                .queueFamilyIndex = compute_queue_family_index,
+                .queueCount = 1,
+                .pQueuePriorities = &queue_priority,
+            },
         };
+        const auto queue_info_count = compute_queue_family_index == graphics_queue_family_index ? 1u : 2u;
 
         // Enabled device extensions
         std::vector<const char*> enabled_extensions;
@@ -256,24 +284,97 @@ namespace orion
             enabled_extensions.push_back("VK_KHR_portability_subset");
         }
 
+        // Optional device extensions, their feature structs may only be queried when the extension is available
+        std::uint32_t extension_count = 0;
+        vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+        std::vector<VkExtensionProperties> extensions(extension_count);
+        vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, extensions.data());
+        const auto has_extension = [&](std::string_view name) {
+            return std::ranges::any_of(extensions, [&](const VkExtensionProperties& extension) { return name == extension.extensionName; });
+        };
+        auto shader_module_identifier_features = VkPhysicalDeviceShaderModuleIdentifierFeaturesEXT{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_MODULE_IDENTIFIER_FEATURES_EXT,
+            .pNext = nullptr,
+            .shaderModuleIdentifier = VK_FALSE,
+        };
+        auto graphics_pipeline_library_features = VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+            .pNext = nullptr,
+            .graphicsPipelineLibrary = VK_FALSE,
+        };
+        auto supported_features = VkPhysicalDeviceFeatures2{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = nullptr,
+            .features = {},
+        };
+        const bool has_graphics_pipeline_library = has_extension("VK_KHR_pipeline_library") && has_extension("VK_EXT_graphics_pipeline_library");
+        if (has_extension("VK_EXT_shader_module_identifier")) {
+            shader_module_identifier_features.pNext = std::exchange(supported_features.pNext, &shader_module_identifier_features);
+        }
+        if (has_graphics_pipeline_library) {
+            graphics_pipeline_library_features.pNext = std::exchange(supported_features.pNext, &graphics_pipeline_library_features);
+        }
+        vkGetPhysicalDeviceFeatures2(physical_device, &supported_features);
+
+        // Only the supported feature structs are chained to enable them
+        void* enabled_features = nullptr;
+        auto features = VulkanDeviceFeatures{};
+        if (shader_module_identifier_features.shaderModuleIdentifier) {
+            enabled_extensions.push_back("VK_EXT_shader_module_identifier");
+            shader_module_identifier_features.pNext = std::exchange(enabled_features, &shader_module_identifier_features);
+            features.shader_module_identifier = true;
+        }
+        ORION_RENDERER_LOG_DEBUG("VK_EXT_shader_module_identifier {}", features.shader_module_identifier ? "enabled" : "not supported");
+
+        // Pipeline libraries are only worth it when linking them is fast
+        if (graphics_pipeline_library_features.graphicsPipelineLibrary) {
+            auto graphics_pipeline_library_properties = VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT{
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT,
+                .pNext = nullptr,
+                .graphicsPipelineLibraryFastLinking = VK_FALSE,
+                .graphicsPipelineLibraryIndependentInterpolationDecoration = VK_FALSE,
+            };
+            auto library_properties = VkPhysicalDeviceProperties2{
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                .pNext = &graphics_pipeline_library_properties,
+                .properties = {},
+            };
+            vkGetPhysicalDeviceProperties2(physical_device, &library_properties);
+            if (graphics_pipeline_library_properties.graphicsPipelineLibraryFastLinking) {
+                enabled_extensions.push_back("VK_KHR_pipeline_library");
+                enabled_extensions.push_back("VK_EXT_graphics_pipeline_library");
+                graphics_pipeline_library_features.pNext = std::exchange(enabled_features, &graphics_pipeline_library_features);
+                features.graphics_pipeline_library = true;
+            }
+        }
+        ORION_RENDERER_LOG_DEBUG("VK_EXT_graphics_pipeline_library {}", features.graphics_pipeline_library ? "enabled" : "not supported");
+
         // Create device
+        //  Pipeline creation cache control lets pipeline creation fail instead of compiling
         auto vulkan_13_features = VkPhysicalDeviceVulkan13Features{
             .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
-            .pNext = nullptr,
+            .pNext = enabled_features,
+            .pipelineCreationCacheControl = VK_TRUE,
             .synchronization2 = VK_TRUE,
             .dynamicRendering = VK_TRUE,
         };
-        const auto vulkan_12_features = VkPhysicalDeviceVulkan12Features{
+        auto vulkan_12_features = VkPhysicalDeviceVulkan12Features{
             .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
             .pNext = &vulkan_13_features,
             .timelineSemaphore = VK_TRUE,
         };
+        // Multiview is required by Vulkan 1.1
+        const auto vulkan_11_features = VkPhysicalDeviceVulkan11Features{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
+            .pNext = &vulkan_12_features,
+            .multiview = VK_TRUE,
+        };
         const auto device_info = VkDeviceCreateInfo{
             .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-            .pNext = &vulkan_12_features,
+            .pNext = &vulkan_11_features,
             .flags = {},
-            .queueCreateInfoCount = 1,
-            .pQueueCreateInfos = &queue_info,
+            .queueCreateInfoCount = queue_info_count,
+            .pQueueCreateInfos = queue_infos.data(),
             .enabledExtensionCount = static_cast<std::uint32_t>(enabled_extensions.size()),
             .ppEnabledExtensionNames = enabled_extensions.data(),
         };
@@ -291,6 +392,13 @@ namespace orion
         vkGetDeviceQueue(device, graphics_queue_family_index, 0, &graphics_queue);
         ORION_RENDERER_LOG_INFO("Acquired VkQueue (graphics) {}", fmt::ptr(graphics_queue));
 
+        // Get created compute queue
+        VkQueue compute_queue = graphics_queue;
+        if (compute_queue_family_index != graphics_queue_family_index) {
+            vkGetDeviceQueue(device, compute_queue_family_index, 0, &compute_queue);
+            ORION_RENDERER_LOG_INFO("Acquired VkQueue (compute) {}", fmt::ptr(compute_queue));
+        }
+
         // Initialize VulkanMemoryAllocator
         VmaVulkanFunctions vma_functions = {};
         const auto vma_info = VmaAllocatorCreateInfo{
@@ -321,7 +429,17 @@ namespace orion
             ORION_RENDERER_LOG_INFO("Created VmaAllocator {}", fmt::ptr(vma_allocator));
         }
 
-        return VulkanDevice{device, vma_allocator, physical_device, vk_instance, graphics_queue_family_index, graphics_queue};
+        return VulkanDevice{
+            device,
+            vma_allocator,
+            physical_device,
+            vk_instance,
+            graphics_queue_family_index,
+            graphics_queue,
+            compute_queue_family_index,
+            compute_queue,
+            features,
+        };
     }
 
     VulkanDevice::VulkanDevice(
@@ -330,13 +448,19 @@ namespace orion
         VkPhysicalDevice physical_device,
         VkInstance instance,
         std::uint32_t _graphics_queue_family,
-        VkQueue _graphics_queue)
+        VkQueue _graphics_queue,
+        std::uint32_t _compute_queue_family,
+        VkQueue _compute_queue,
+        VulkanDeviceFeatures _features)
         : vk_device(device)
         , vma_allocator(_vma_allocator)
         , vk_physical_device(physical_device)
         , vk_instance(instance)
         , graphics_queue_family(_graphics_queue_family)
         , graphics_queue(_graphics_queue)
+        , compute_queue_family(_compute_queue_family)
+        , compute_queue(_compute_queue)
+        , features(_features)
     {
     }
 
@@ -347,6 +471,9 @@ namespace orion
         , vk_instance(other.vk_instance)
         , graphics_queue_family(other.graphics_queue_family)
         , graphics_queue(other.graphics_queue)
+        , compute_queue_family(other.compute_queue_family)
+        , compute_queue(other.compute_queue)
+        , features(other.features)
     {
     }
 
@@ -366,6 +493,9 @@ namespace orion
             vk_instance = other.vk_instance;
             graphics_queue_family = other.graphics_queue_family;
             graphics_queue = other.graphics_queue;
+            compute_queue_family = other.compute_queue_family;
+            compute_queue = other.compute_queue;
+            features = other.features;
         }
         return *this;
     }
@@ -627,6 +757,26 @@ namespace orion
         }
     }
 
+    tl::expected<VulkanQueryPool, VkResult> VulkanDevice::create_timestamp_query_pool(std::uint32_t query_count)
+    {
+        const auto query_pool_info = VkQueryPoolCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = {},
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = query_count,
+            .pipelineStatistics = {},
+        };
+        VkQueryPool query_pool = VK_NULL_HANDLE;
+        if (VkResult err = vkCreateQueryPool(vk_device, &query_pool_info, nullptr, &query_pool)) {
+            ORION_RENDERER_LOG_ERROR("vkCreateQueryPool() failed: {}", string_VkResult(err));
+            return tl::unexpected(err);
+        } else {
+            ORION_RENDERER_LOG_INFO("Created VkQueryPool (timestamp) {}", fmt::ptr(query_pool));
+            return VulkanQueryPool{vk_device, query_pool, query_count};
+        }
+    }
+
     tl::expected<void, VkResult> VulkanDevice::wait_idle()
     {
         if (VkResult err = vkDeviceWaitIdle(vk_device)) {
@@ -871,6 +1021,42 @@ namespace orion
         }
     }
 
+    VulkanQueryPool::VulkanQueryPool(VkDevice device, VkQueryPool query_pool, std::uint32_t _query_count)
+        : vk_device(device)
+        , vk_query_pool(query_pool)
+        , query_count(_query_count)
+    {
+    }
+
+    VulkanQueryPool::VulkanQueryPool(VulkanQueryPool&& other) noexcept
+        : vk_device(other.vk_device)
+        , vk_query_pool(std::exchange(other.vk_query_pool, VK_NULL_HANDLE))
+        , query_count(other.query_count)
+    {
+    }
+
+    VulkanQueryPool& VulkanQueryPool::operator=(VulkanQueryPool&& other) noexcept
+    {
+        if (this != &other) {
+            if (vk_query_pool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(vk_device, vk_query_pool, nullptr);
+                ORION_RENDERER_LOG_INFO("Destroyed VkQueryPool {}", fmt::ptr(vk_query_pool));
+            }
+            vk_device = other.vk_device;
+            vk_query_pool = std::exchange(other.vk_query_pool, VK_NULL_HANDLE);
+            query_count = other.query_count;
+        }
+        return *this;
+    }
+
+    VulkanQueryPool::~VulkanQueryPool()
+    {
+        if (vk_query_pool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(vk_device, vk_query_pool, nullptr);
+            ORION_RENDERER_LOG_INFO("Destroyed VkQueryPool {}", fmt::ptr(vk_query_pool));
+        }
+    }
+
     VulkanSemaphore::VulkanSemaphore(VkDevice device, VkSemaphore semaphore)
         : vk_device(device)
         , vk_semaphore(semaphore)
@@ -29,6 +29,20 @@ namespace orion
         tl::expected<void, VkResult> wait(std::uint64_t value, std::uint64_t timeout);
     };
 
+    struct VulkanQueryPool {
+        VkDevice vk_device = VK_NULL_HANDLE;
+        VkQueryPool vk_query_pool = VK_NULL_HANDLE;
+        std::uint32_t query_count = 0;
+
+        VulkanQueryPool() = default;
+        VulkanQueryPool(VkDevice device, VkQueryPool query_pool, std::uint32_t _query_count);
+        VulkanQueryPool(const VulkanQueryPool&) = delete;
+        VulkanQueryPool& operator=(const VulkanQueryPool&) = delete;
+        VulkanQueryPool(VulkanQueryPool&& other) noexcept;
+        VulkanQueryPool& operator=(VulkanQueryPool&& other) noexcept;
+        ~VulkanQueryPool();
+    };
+
     struct VulkanCommandPool {
         static constexpr auto max_command_buffers = 8;
 
@@ -115,6 +129,14 @@ namespace orion
         VkSwapchainKHR old_swapchain = VK_NULL_HANDLE;
     };
 
+    // Optional device features, enabled when the device supports them
+    struct VulkanDeviceFeatures {
+        // VK_EXT_shader_module_identifier
+        bool shader_module_identifier = false;
+        // VK_EXT_graphics_pipeline_library with fast linking
+        bool graphics_pipeline_library = false;
+    };
+
     struct VulkanDevice {
         VkDevice vk_device;
         VmaAllocator vma_allocator;
@@ -124,13 +146,22 @@ namespace orion
         std::uint32_t graphics_queue_family;
         VkQueue graphics_queue;
 
+        // Same as the graphics queue if the device has no dedicated compute queue family
+        std::uint32_t compute_queue_family;
+        VkQueue compute_queue;
+
+        VulkanDeviceFeatures features;
+
         VulkanDevice(
             VkDevice device,
             VmaAllocator _vma_allocator,
             VkPhysicalDevice physical_device,
             VkInstance instance,
             std::uint32_t _graphics_queue_family,
-            VkQueue _graphics_queue);
+            VkQueue _graphics_queue,
+            std::uint32_t _compute_queue_family,
+            VkQueue _compute_queue,
+            VulkanDeviceFeatures _features);
         VulkanDevice(const VulkanDevice&) = delete;
         VulkanDevice& operator=(const VulkanDevice&) = delete;
         VulkanDevice(VulkanDevice&& other) noexcept;
@@ -142,6 +173,7 @@ namespace orion
         tl::expected<VulkanCommandPool, VkResult> create_command_pool(const VulkanCommandPoolDesc& desc);
         tl::expected<VulkanSemaphore, VkResult> create_binary_semaphore();
         tl::expected<VulkanSemaphore, VkResult> create_timeline_semaphore(std::uint64_t initial_value);
+        tl::expected<VulkanQueryPool, VkResult> create_timestamp_query_pool(std::uint32_t query_count);
 
         tl::expected<void, VkResult> wait_idle();
     };
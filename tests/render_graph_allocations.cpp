@@ -0,0 +1,138 @@
+#include "orion/log.hpp"
+#include "orion/renderer/render_graph.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+// Every heap allocation of the process goes through the replaced operator new and is counted
+static std::atomic<std::size_t> allocation_count = 0;
+
+static void* counted_allocate(std::size_t size)
+{
+    ++allocation_count;
+    if (void* ptr = std::malloc(size != 0 ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t size) { return counted_allocate(size); }
+void* operator new[](std::size_t size) { return counted_allocate(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// The graph only touches imported resources, the frame semaphore read by the transient heap is the only device call
+//  Every frame is reported complete, nothing is in flight without a device.
+static std::uint64_t completed_frame_value = 0;
+
+static VkResult VKAPI_CALL get_semaphore_counter_value(VkDevice, VkSemaphore, std::uint64_t* value)
+{
+    *value = completed_frame_value;
+    return VK_SUCCESS;
+}
+
+template<typename T>
+static T fake_handle(std::uintptr_t value)
+{
+    return reinterpret_cast<T>(value);
+}
+
+// Declares a frame shaped like the renderer's, particles feeding the scene pass, post processing and ImGui
+//  Passes are compiled but never recorded, there is no device to record them on.
+static void build_frame(orion::RenderGraph& graph, std::uint64_t frame_value)
+{
+    using namespace orion;
+
+    graph.reset(frame_value);
+    auto swapchain_texture = graph.import_texture({
+        .image = fake_handle<VkImage>(0x10),
+        .view = fake_handle<VkImageView>(0x11),
+        .current_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .final_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        .format = VK_FORMAT_B8G8R8A8_SRGB,
+        .extent = {1280, 720, 1},
+    });
+    auto scene_texture = graph.import_texture({
+        .image = fake_handle<VkImage>(0x20),
+        .view = fake_handle<VkImageView>(0x21),
+        .current_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+        .extent = {1280, 720, 1},
+    });
+    auto depth_texture = graph.import_texture({
+        .image = fake_handle<VkImage>(0x30),
+        .view = fake_handle<VkImageView>(0x31),
+        .current_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .final_layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        .format = VK_FORMAT_D32_SFLOAT,
+        .extent = {1280, 720, 1},
+    });
+    auto particle_buffer = graph.import_buffer({.buffer = fake_handle<VkBuffer>(0x40), .size = 64 * 1024});
+
+    graph.add_pass("Simulate particles", [&](RenderPassBuilder& builder) {
+        particle_buffer = builder.write_buffer(particle_buffer, BufferUsage::StorageWrite);
+        return [](RenderPassContext&) {};
+    });
+    graph.add_pass("Scene", [&](RenderPassBuilder& builder) {
+        builder.read_buffer(particle_buffer, BufferReadUsage::StorageRead);
+        scene_texture = builder.write_texture(scene_texture, TextureUsage::ColorAttachment);
+        depth_texture = builder.write_texture(depth_texture, TextureUsage::DepthAttachment);
+        builder.set_rendering({.extent = {1280, 720}});
+        builder.set_clear_value(scene_texture, {.color = {{0.0f, 0.0f, 0.0f, 1.0f}}});
+        builder.set_clear_value(depth_texture, {.depthStencil = {1.0f, 0}});
+        return [](RenderPassContext&) {};
+    });
+    graph.add_pass("Tonemap", [&](RenderPassBuilder& builder) {
+        builder.read_texture(scene_texture, TextureReadUsage::Sampled);
+        swapchain_texture = builder.write_texture(swapchain_texture, TextureUsage::ColorAttachment);
+        builder.set_rendering({.extent = {1280, 720}});
+        return [](RenderPassContext&) {};
+    });
+    graph.add_pass("ImGui", [&](RenderPassBuilder& builder) {
+        swapchain_texture = builder.write_texture(swapchain_texture, TextureUsage::ColorAttachment);
+        builder.set_rendering({.extent = {1280, 720}});
+        return [](RenderPassContext&) {};
+    });
+    graph.compile();
+    completed_frame_value = frame_value;
+}
+
+int main()
+{
+    auto logger = orion::Logger::initialize();
+    if (!logger) {
+        std::fprintf(stderr, "Failed to initialize logger: %s\n", logger.error().c_str());
+        return 1;
+    }
+    vkGetSemaphoreCounterValue = get_semaphore_counter_value;
+
+    auto transient_heap = std::make_shared<orion::TransientHeap>(fake_handle<VkDevice>(0x1), fake_handle<VmaAllocator>(0x2), fake_handle<VkSemaphore>(0x3));
+    auto graph = orion::RenderGraph{fake_handle<VkDevice>(0x1), fake_handle<VmaAllocator>(0x2), transient_heap, 0, 0};
+
+    // The first frames size the arena and the containers kept between frames
+    constexpr std::uint64_t warmup_frames = 3;
+    constexpr std::uint64_t measured_frames = 16;
+    std::uint64_t frame_value = 1;
+    for (; frame_value <= warmup_frames; ++frame_value) {
+        build_frame(graph, frame_value);
+    }
+
+    const std::size_t allocations_before = allocation_count;
+    for (; frame_value <= warmup_frames + measured_frames; ++frame_value) {
+        build_frame(graph, frame_value);
+    }
+    const std::size_t allocations = allocation_count - allocations_before;
+
+    if (allocations != 0) {
+        std::fprintf(stderr, "%zu heap allocations in %llu steady state frames, expected none\n", allocations, static_cast<unsigned long long>(measured_frames));
+        return 1;
+    }
+    return 0;
+}